@@ -0,0 +1,246 @@
+/**
+ * Host test of FiltrationPlanner: plans against brute force, price layers.
+ *
+ * Each case gives the slots random costs and a random minimum run, lets the
+ * planner plan from an earlier slot (so a block may run into the current
+ * one) and then from a slot late in the day with a random runtime still
+ * needed. All plans of the remaining slots are enumerated: the planner has to
+ * pick the fewest slots which deliver the runtime, in blocks of at least the
+ * minimum run, at the least penalty of all such plans. When the day is too
+ * short for the runtime it has to plan as many slots as possible. The penalty
+ * is computed here once more from the formula, not taken from the planner.
+ *
+ * The price layers are checked as well: prices of today and tomorrow are kept,
+ * prices of a past day or a day after tomorrow are rejected and never evict
+ * the prices of today.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=gnu++11 -Ibench/host -Isrc bench/filtration_planner_test.cpp src/FiltrationPlanner.cpp \
+ *       -o filtration_planner_test && ./filtration_planner_test
+ */
+
+#include "FiltrationPlanner.hpp"
+
+static const uint8_t  FIRST_SLOT = 34;   // 14 slots left, 16384 plans
+static const int      CASES      = 3000;
+static const uint16_t DAY        = 9700;
+
+static const uint8_t SLOTS = FiltrationPlanner::SLOTS;
+
+static uint32_t seed = 1;
+
+/**
+ * Pseudo random number below limit, the same on every run.
+ */
+static uint32_t random(const uint32_t limit) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % limit;
+}
+
+/**
+ * Penalty of a slot like FiltrationPlanner::penalty(): missing sun (solar noon 13:30, 6 h wide) plus cost.
+ */
+static uint16_t penaltyOf(const uint8_t slot, const uint8_t* cost) {
+  const int center   = slot * 30 + 15;
+  const int distance = abs(center - (13 * 60 + 30));
+  const int sun      = (distance < 6 * 60) ? 100 - (100 * distance) / (6 * 60) : 0;
+  return 100 - sun + cost[slot];
+}
+
+/**
+ * Whether the plan of the slots from current on has only blocks of at least minRun slots, with a block of length
+ * run running into current.
+ */
+static bool isValid(const uint64_t plan, const uint8_t current, uint8_t run, const uint8_t minRun) {
+  for (uint8_t slot = current; slot < SLOTS; slot++) {
+    if ((plan >> slot) & 1) {
+      run = (run < minRun) ? run + 1 : minRun;
+    } else if (run > 0 && run < minRun) {
+      return false;
+    } else {
+      run = 0;
+    }
+  }
+  return run == 0 || run == minRun;
+}
+
+static uint16_t costOf(const uint64_t plan, const uint8_t current, const uint8_t* cost) {
+  uint16_t sum = 0;
+  for (uint8_t slot = current; slot < SLOTS; slot++) {
+    sum += ((plan >> slot) & 1) ? penaltyOf(slot, cost) : 0;
+  }
+  return sum;
+}
+
+/**
+ * One random case; the number of failures.
+ */
+static int checkPlan(const int number) {
+  FiltrationPlanner planner;
+  uint8_t           cost[SLOTS];
+  planner.update(DAY, 0, 0, 0);
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    cost[slot] = random(256);
+    planner.setSlotCost(slot, cost[slot]);
+  }
+  const uint8_t minRun = 1 + random(FiltrationPlanner::MAX_MIN_RUN);
+  planner.setMinRun(minRun);
+
+  const uint32_t slotSeconds = FiltrationPlanner::SLOT_SECONDS;
+  const uint8_t  current     = FIRST_SLOT + random(SLOTS - FIRST_SLOT);
+  const uint32_t offset      = (random(2) == 0) ? 0 : random(slotSeconds);
+  const uint8_t  free        = SLOTS - current;
+
+  // an earlier plan, whose block may run into the current slot
+  if (random(4) != 0) {
+    const uint8_t earlier = current - 1 - random(6);
+    planner.update(DAY, earlier * slotSeconds, (1 + random(free + 4)) * slotSeconds, 0);
+  }
+  const uint64_t past = planner.getPlan() & ((1ULL << current) - 1);
+  uint8_t        run  = 0;
+  while (run < minRun && run < current && ((past >> (current - 1 - run)) & 1)) {
+    run++;
+  }
+
+  const uint32_t need = 1 + random(free * slotSeconds);
+  planner.update(DAY, current * slotSeconds + offset, need, 0);
+  const uint64_t plan = planner.getPlan() & ~((1ULL << current) - 1);
+  const uint8_t  used = __builtin_popcountll(plan);
+
+  // all plans of the free slots: the least penalty per number of slots, and the fewest slots delivering the runtime
+  uint16_t best[SLOTS + 1];
+  for (uint8_t count = 0; count <= SLOTS; count++) {
+    best[count] = 0xFFFF;
+  }
+  int fewest = -1;
+  int most   = -1;  // without enough time left
+  for (uint32_t bits = 0; bits < (1UL << free); bits++) {
+    const uint64_t candidate = (uint64_t)bits << current;
+    if (!isValid(candidate, current, run, minRun)) {
+      continue;
+    }
+    const uint8_t  count    = __builtin_popcount(bits);
+    const uint16_t sum      = costOf(candidate, current, cost);
+    const uint32_t capacity = count * slotSeconds - ((bits & 1) ? offset : 0);
+    best[count]             = (sum < best[count]) ? sum : best[count];
+    most                    = (count > most) ? count : most;
+    if (capacity >= need && (fewest < 0 || count < fewest)) {
+      fewest = count;
+    }
+  }
+
+  const uint32_t capacity = used * slotSeconds - ((plan >> current) & 1 ? offset : 0);
+  const char*    error    = nullptr;
+  if (!isValid(plan, current, run, minRun)) {
+    error = "blocks shorter than the minimum run";
+  } else if (fewest < 0) {
+    error = (most >= 0 && used != most) ? "fewer slots than possible" : nullptr;
+  } else if (capacity < need) {
+    error = "runtime not delivered";
+  } else if (offset == 0 && used != fewest) {
+    // a partly passed current slot may need one slot more than the fewest
+    error = "more slots than needed";
+  } else if (offset != 0 && used > fewest + 1) {
+    error = "more slots than needed";
+  } else if (used > 0 && costOf(plan, current, cost) != best[used]) {
+    error = "not the least penalty";
+  }
+
+  if (error != nullptr) {
+    printf("case %d, slot %u + %lu s, min run %u, run %u, need %lu s: %s\n", number, current, (unsigned long)offset,
+           minRun, run, (unsigned long)need, error);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Cost of a slot for the prices of a layer, like FiltrationPlanner::applyPrices().
+ */
+static uint8_t costFor(const int16_t* prices, const uint8_t count, const uint8_t slot) {
+  int16_t lowest  = prices[0];
+  int16_t highest = prices[0];
+  for (uint8_t i = 1; i < count; i++) {
+    lowest  = (prices[i] < lowest) ? prices[i] : lowest;
+    highest = (prices[i] > highest) ? prices[i] : highest;
+  }
+  return (highest > lowest) ? ((int32_t)prices[slot * count / SLOTS] - lowest) * 255 / (highest - lowest) : 0;
+}
+
+static int expect(const bool condition, const char* what) {
+  if (!condition) {
+    printf("prices: %s\n", what);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Price layers of today and tomorrow; the number of failures.
+ */
+static int checkPrices() {
+  int16_t today[24];
+  int16_t tomorrow[48];
+  int16_t later[24];
+  for (uint8_t i = 0; i < 48; i++) {
+    tomorrow[i] = 3000 - 50 * i;
+    if (i < 24) {
+      today[i] = 2000 + ((i * 7) % 24) * 25;
+      later[i] = 100 * i;
+    }
+  }
+
+  FiltrationPlanner planner;
+  int               failures = 0;
+
+  // before the first update any day goes
+  failures += expect(planner.setPrices(DAY, today, 24), "today before the first update rejected");
+  planner.update(DAY, 0, 0, 0);
+  failures += expect(planner.setPrices(DAY, today, 24), "today rejected");
+  failures += expect(!planner.setPrices(DAY - 1, later, 24), "yesterday accepted");
+  failures += expect(!planner.setPrices(DAY + 2, later, 24), "day after tomorrow accepted");
+  failures += expect(planner.hasPrices(DAY), "prices of today evicted");
+  failures += expect(planner.setPrices(DAY + 1, tomorrow, 48), "tomorrow rejected");
+  failures += expect(!planner.setPrices(DAY + 2, later, 24), "day after tomorrow accepted with two layers in use");
+  failures += expect(planner.hasPrices(DAY) && planner.hasPrices(DAY + 1), "prices of today or tomorrow evicted");
+  failures += expect(!planner.setPrices(DAY + 1, later, 7), "count which does not divide the slots accepted");
+
+  bool costs = true;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    costs = costs && planner.getSlotCost(slot) == costFor(today, 24, slot);
+  }
+  failures += expect(costs, "costs do not follow the prices of today");
+
+  // at midnight tomorrow becomes today, the layer of yesterday is free again
+  planner.update(DAY + 1, 0, 0, 0);
+  costs = true;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    costs = costs && planner.getSlotCost(slot) == costFor(tomorrow, 48, slot);
+  }
+  failures += expect(costs, "costs do not follow the prices of tomorrow after midnight");
+  failures += expect(!planner.hasPrices(DAY), "prices of yesterday kept");
+  failures += expect(planner.setPrices(DAY + 2, later, 24), "new tomorrow rejected");
+  failures += expect(planner.hasPrices(DAY + 1) && planner.hasPrices(DAY + 2), "prices of the new days missing");
+
+  // without prices for the day all slots cost the same
+  planner.update(DAY + 4, 0, 0, 0);
+  costs = true;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    costs = costs && planner.getSlotCost(slot) == 0;
+  }
+  failures += expect(costs, "costs left from an earlier day");
+  return failures;
+}
+
+int main() {
+  int failures = 0;
+  for (int number = 0; number < CASES; number++) {
+    failures += checkPlan(number);
+  }
+  printf("%d plans against brute force: %d failures\n", CASES, failures);
+
+  const int priceFailures = checkPrices();
+  printf("price layers: %d failures\n", priceFailures);
+  return (failures + priceFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+/**
+ * Host test of FlashJournal on the ESP8266: power cuts during writes and compactions.
+ *
+ * The flash is simulated in RAM like NOR flash: erasing sets a sector to 0xFF,
+ * programming can only clear bits. A run writes three record types over and
+ * over, through several compactions, and cuts the power after a given number
+ * of flash operations. The operation hit by the cut is torn: half of a write is
+ * programmed, half of a sector erased. The journal is then opened again as
+ * after a reboot and has to return for each type the last value written
+ * successfully or the one being written at the cut. After that the run goes
+ * on for a while and is checked once more, so the journal also has to recover
+ * from what the cut left behind. Each flash operation of the run is cut once.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=gnu++11 -DESP8266 -Ibench/host -Isrc bench/flash_journal_test.cpp src/FlashJournal.cpp \
+ *       src/NodeStrings.cpp -no-pie -Wl,--defsym,_EEPROM_start=0x405FB000 -Wl,--defsym,_FS_end=0x405FA000 \
+ *       -o flash_journal_test && ./flash_journal_test
+ *
+ * _EEPROM_start and _FS_end are placed like in the 4 MB layouts of the ESP8266
+ * core, with one free sector between file system and EEPROM.
+ */
+
+#include "FlashJournal.hpp"
+#include <Homie.hpp>
+#include <spi_flash.h>
+
+extern "C" uint32_t _EEPROM_start;
+
+EspClass   ESP;
+HomieClass Homie;
+
+static const uint8_t  TYPES  = 3;
+static const uint32_t WRITES = 600;  // per run, about six compactions
+
+static uint8_t flash[2 * SPI_FLASH_SEC_SIZE];  // the sector below the EEPROM sector, then the EEPROM sector
+static long    budget = -1;                    // flash operations until the power cut, -1 for none
+static int     operations;
+
+struct PowerCut {};
+
+/**
+ * Offset in flash[] of an address of the two sectors.
+ */
+static uint32_t offsetOf(const uint32_t address) {
+  return address - ((uintptr_t)&_EEPROM_start - 0x40200000 - SPI_FLASH_SEC_SIZE);
+}
+
+/**
+ * Counts the operation; true if the power is cut during it.
+ */
+static bool cutNow() {
+  operations++;
+  if (budget == 0) {
+    return true;
+  }
+  budget -= (budget > 0) ? 1 : 0;
+  return false;
+}
+
+bool EspClass::flashEraseSector(uint32_t sector) {
+  const uint32_t offset = offsetOf(sector * SPI_FLASH_SEC_SIZE);
+  const bool     cut    = cutNow();
+  memset(flash + offset, 0xFF, cut ? SPI_FLASH_SEC_SIZE / 2 : SPI_FLASH_SEC_SIZE);
+  if (cut) {
+    throw PowerCut();
+  }
+  return true;
+}
+
+bool EspClass::flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+  const uint32_t offset = offsetOf(address);
+  const bool     cut    = cutNow();
+  for (size_t i = 0; i < (cut ? size / 2 : size); i++) {
+    flash[offset + i] &= reinterpret_cast<const uint8_t*>(data)[i];
+  }
+  if (cut) {
+    throw PowerCut();
+  }
+  return true;
+}
+
+bool EspClass::flashRead(uint32_t address, uint32_t* data, size_t size) {
+  memcpy(data, flash + offsetOf(address), size);
+  return true;
+}
+
+/**
+ * Record of a type, padded so a sector holds about 90 of them.
+ */
+struct Record {
+  uint32_t value;
+  uint8_t  type;
+  uint8_t  padding[35];
+};
+
+/**
+ * Write the next values round robin from write number from on until to or the power cut.
+ * written[] holds the last value written successfully per type, writing[] the one in progress.
+ */
+static void run(const uint32_t from, const uint32_t to, uint32_t* written, uint32_t* writing) {
+  FlashJournal journal;
+  try {
+    for (uint32_t n = from; n < to; n++) {
+      const uint8_t type = n % TYPES;
+      Record        record;
+      memset(&record, 0, sizeof(record));
+      record.value   = n + 1;
+      record.type    = type + 1;
+      writing[type]  = record.value;
+      if (journal.write(type + 1, &record, sizeof(record))) {
+        written[type] = record.value;
+      }
+    }
+  } catch (const PowerCut&) {
+  }
+}
+
+/**
+ * Read all types as after a reboot; the number of types which lost their value.
+ */
+static int check(const uint32_t* written, const uint32_t* writing, const long cut) {
+  FlashJournal journal;
+  int          failures = 0;
+  for (uint8_t type = 0; type < TYPES; type++) {
+    Record     record;
+    const bool found = journal.read(type + 1, &record, sizeof(record));
+    const bool valid = found ? (record.value == written[type] || record.value == writing[type]) : (written[type] == 0);
+    if (!valid) {
+      printf("cut at operation %ld: type %u is %lu, expected %lu or %lu\n", cut, type + 1,
+             found ? (unsigned long)record.value : 0UL, (unsigned long)written[type], (unsigned long)writing[type]);
+      failures++;
+    }
+  }
+  return failures;
+}
+
+int main() {
+  // count the operations of a run without a cut
+  uint32_t written[TYPES] = {0};
+  uint32_t writing[TYPES] = {0};
+  memset(flash, 0xFF, sizeof(flash));
+  operations = 0;
+  run(0, WRITES, written, writing);
+  const int total    = operations;
+  int       failures = check(written, writing, -1);
+
+  for (long cut = 0; cut < total; cut++) {
+    memset(flash, 0xFF, sizeof(flash));
+    memset(written, 0, sizeof(written));
+    memset(writing, 0, sizeof(writing));
+
+    budget = cut;
+    run(0, WRITES, written, writing);
+    budget = -1;
+    failures += check(written, writing, cut);
+
+    // the journal goes on from whatever the cut left behind
+    memcpy(writing, written, sizeof(writing));
+    run(WRITES, 2 * WRITES, written, writing);
+    failures += check(written, writing, cut);
+  }
+
+  printf("%d flash operations per run, each cut once: %d lost values\n", total, failures);
+  return failures == 0 ? 0 : 1;
+}
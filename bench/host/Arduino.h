@@ -0,0 +1,46 @@
+/**
+ * Host stand-in for the Arduino core, just enough for the host tests in bench/.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#define PROGMEM
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+
+/**
+ * Arduino String, as far as the nodes under test use it.
+ */
+class String {
+
+public:
+  String(const char* text = "") : _text(text) {}
+
+  const char* c_str() const { return _text.c_str(); }
+  bool        equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+
+private:
+  std::string _text;
+};
+
+/**
+ * Flash access of the ESP8266 core, implemented by the test.
+ */
+class EspClass {
+
+public:
+  bool flashEraseSector(uint32_t sector);
+  bool flashWrite(uint32_t address, const uint32_t* data, size_t size);
+  bool flashRead(uint32_t address, uint32_t* data, size_t size);
+};
+
+extern EspClass ESP;
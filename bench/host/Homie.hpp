@@ -0,0 +1,73 @@
+/**
+ * Host stand-in for Homie: the logger discards everything, nodes are never connected.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+struct HomieEndl {};
+static const HomieEndl endl = {};
+
+class HomieLogger {
+
+public:
+  template <typename T>
+  HomieLogger& operator<<(const T&) {
+    return *this;
+  }
+};
+
+class HomieClass {
+
+public:
+  HomieLogger& getLogger() { return _logger; }
+  bool         isConnected() const { return false; }
+
+private:
+  HomieLogger _logger;
+};
+
+extern HomieClass Homie;
+
+struct HomieRange {
+  bool     isRange;
+  uint16_t index;
+};
+
+/**
+ * Advertised property and value to send, every call is ignored.
+ */
+class HomieProperty {
+
+public:
+  HomieProperty& setName(const char*) { return *this; }
+  HomieProperty& setDatatype(const char*) { return *this; }
+  HomieProperty& setFormat(const char*) { return *this; }
+  HomieProperty& setUnit(const char*) { return *this; }
+  HomieProperty& settable() { return *this; }
+  HomieProperty& setRetained(const bool) { return *this; }
+  void           send(const String&) {}
+};
+
+class HomieNode {
+
+public:
+  HomieNode(const char* id, const char* name, const char* type) : _id(id), _name(name), _type(type) {}
+  virtual ~HomieNode() {}
+
+  const char* getId() const { return _id; }
+
+protected:
+  virtual void setup() {}
+  virtual bool handleInput(const HomieRange&, const String&, const String&) { return false; }
+
+  HomieProperty& advertise(const char*) { return _property; }
+  HomieProperty& setProperty(const char*) { return _property; }
+
+private:
+  const char*   _id;
+  const char*   _name;
+  const char*   _type;
+  HomieProperty _property;
+};
@@ -0,0 +1,7 @@
+/**
+ * Host stand-in for NTPClient, included by TimeClientHelper.hpp.
+ */
+
+#pragma once
+
+class NTPClient {};
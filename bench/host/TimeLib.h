@@ -0,0 +1,8 @@
+/**
+ * Host stand-in for TimeLib: the Arduino core like the original, time_t and localtime() of the C library.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
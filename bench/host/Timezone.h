@@ -0,0 +1,9 @@
+/**
+ * Host stand-in for Timezone, only the types TimeClientHelper.hpp declares.
+ */
+
+#pragma once
+
+struct TimeChangeRule {};
+
+class Timezone {};
@@ -0,0 +1,7 @@
+/**
+ * Host stand-in for WiFiUdp, included by TimeClientHelper.hpp.
+ */
+
+#pragma once
+
+class WiFiUDP {};
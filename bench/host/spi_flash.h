@@ -0,0 +1,7 @@
+/**
+ * Host stand-in for the flash definitions of the ESP8266 SDK.
+ */
+
+#pragma once
+
+#define SPI_FLASH_SEC_SIZE 4096
@@ -0,0 +1,149 @@
+/**
+ * Host test of the price parsing of TariffNode.
+ *
+ * Documents with 24 and 48 prices go through TariffNode::updatePrices() into a
+ * FiltrationPlanner. The costs of its slots have to equal those of a second
+ * planner which gets the same prices in 1/100 directly, so the rounding and
+ * the spreading of hourly prices over the half-hour slots are covered. Invalid
+ * documents, counts, dates and days have to be rejected and leave the prices
+ * of the planner alone.
+ *
+ * Needs ArduinoJson as downloaded by PlatformIO. Build and run from the
+ * repository root after a build of environment nodemcuv2:
+ *
+ *   g++ -std=gnu++11 -DLOOP_PROFILER=0 -Ibench/host -Isrc -I.pio/libdeps/nodemcuv2/ArduinoJson/src \
+ *       bench/tariff_node_test.cpp src/TariffNode.cpp src/FiltrationPlanner.cpp src/Timer.cpp src/NodeStrings.cpp \
+ *       -o tariff_node_test && ./tariff_node_test
+ */
+
+#include "TariffNode.hpp"
+
+HomieClass Homie;
+
+/**
+ * Local time of TimeClientHelper, not needed by the price parsing.
+ */
+time_t getTimeFor(int, TimeChangeRule**) {
+  return 0;
+}
+
+/**
+ * Document with the prices, each printed with the given number of decimals.
+ */
+static void makeDocument(char* json, const size_t size, const char* date, const float* prices, const uint8_t count,
+                         const int decimals) {
+  size_t length = snprintf(json, size, "{\"date\":\"%s\",\"prices\":[", date);
+  for (uint8_t i = 0; i < count; i++) {
+    length += snprintf(json + length, size - length, "%s%.*f", (i > 0) ? "," : "", decimals, prices[i]);
+  }
+  snprintf(json + length, size - length, "]}");
+}
+
+/**
+ * Whether both planners have the same costs in all slots.
+ */
+static bool sameCosts(const FiltrationPlanner& planner, const FiltrationPlanner& reference) {
+  for (uint8_t slot = 0; slot < FiltrationPlanner::SLOTS; slot++) {
+    if (planner.getSlotCost(slot) != reference.getSlotCost(slot)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int expect(const bool condition, const char* what) {
+  if (!condition) {
+    printf("%s\n", what);
+    return 1;
+  }
+  return 0;
+}
+
+int main() {
+  const uint16_t today    = getDayOf(2026, 10, 20);
+  const uint16_t tomorrow = getDayOf(2026, 10, 21);
+  int            failures = expect(today != 0 && tomorrow == today + 1, "getDayOf() of 2026-10-20 and -21");
+
+  // hourly prices of today between 0.20 and 0.89, most of them not exact as float, half-hourly ones of tomorrow with
+  // negative ones at noon
+  float   hourly[24];
+  float   halfHourly[48];
+  int16_t hourlyCents[24];
+  int16_t halfHourlyCents[48];
+  for (uint8_t i = 0; i < 48; i++) {
+    halfHourly[i]      = 12.5f - 0.75f * ((i * 11) % 48) + ((i >= 22 && i < 28) ? -20.0f : 0.0f);
+    halfHourlyCents[i] = (int16_t)(halfHourly[i] * 100.0f + ((halfHourly[i] < 0) ? -0.5f : 0.5f));
+    if (i < 24) {
+      hourlyCents[i] = 20 + ((i * 7) % 24) * 3;
+      hourly[i]      = hourlyCents[i] / 100.0f;
+    }
+  }
+
+  FiltrationPlanner planner;
+  FiltrationPlanner reference;
+  TariffNode        node("tariff", "Tariff");
+  char              json[1024];
+  char              summary[TariffNode::SUMMARY_SIZE];
+
+  makeDocument(json, sizeof(json), "2026-10-20", hourly, 24, 2);
+  failures += expect(!node.updatePrices(json, summary), "accepted without a planner");
+  node.setPlanner(&planner);
+
+  planner.update(today, 0, 0, 0);
+  reference.update(today, 0, 0, 0);
+  reference.setPrices(today, hourlyCents, 24);
+
+  // 24 prices of today
+  failures += expect(node.updatePrices(json, summary), "24 prices of today rejected");
+  failures += expect(strcmp(summary, "{\"date\":\"2026-10-20\",\"count\":24}") == 0, "summary of 24 prices");
+  failures += expect(planner.hasPrices(today), "24 prices of today missing");
+  failures += expect(sameCosts(planner, reference), "costs of 24 prices differ");
+
+  // 48 prices of tomorrow, with all the decimals a float has
+  makeDocument(json, sizeof(json), "2026-10-21", halfHourly, 48, 7);
+  failures += expect(node.updatePrices(json, summary), "48 prices of tomorrow rejected");
+  failures += expect(strcmp(summary, "{\"date\":\"2026-10-21\",\"count\":48}") == 0, "summary of 48 prices");
+  failures += expect(planner.hasPrices(today) && planner.hasPrices(tomorrow), "prices of today or tomorrow missing");
+  failures += expect(sameCosts(planner, reference), "costs changed by the prices of tomorrow");
+
+  planner.update(tomorrow, 0, 0, 0);
+  reference.update(tomorrow, 0, 0, 0);
+  reference.setPrices(tomorrow, halfHourlyCents, 48);
+  failures += expect(sameCosts(planner, reference), "costs of 48 prices differ");
+
+  // rejected documents leave the prices alone
+  const uint16_t dayAfter = tomorrow + 1;
+  const char*    invalid[] = {
+      "{\"date\":\"2026-10-22\",\"prices\":[1,2,3",
+      "{\"date\":\"2026-10-22\",\"prices\":[1,2,3]}",
+      "{\"date\":\"2026-02-30\",\"prices\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24]}",
+      "{\"prices\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24]}",
+      "{\"date\":\"2026-10-22\",\"prices\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,\"24\"]}",
+      "{\"date\":\"2026-10-22\",\"prices\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,400]}",
+      "{\"date\":\"2026-10-20\",\"prices\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24]}",
+      "{\"date\":\"2026-10-23\",\"prices\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24]}",
+  };
+  const char* reasons[] = {"truncated document", "3 prices", "invalid date", "no date", "price as string",
+                           "price out of range", "prices of yesterday", "prices of the day after tomorrow"};
+  for (uint8_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    if (node.updatePrices(invalid[i], summary)) {
+      printf("accepted: %s\n", reasons[i]);
+      failures++;
+    }
+  }
+
+  float many[49];
+  for (uint8_t i = 0; i < 49; i++) {
+    many[i] = 0.1f * i;
+  }
+  makeDocument(json, sizeof(json), "2026-10-22", many, 49, 1);
+  failures += expect(!node.updatePrices(json, summary), "accepted: 49 prices");
+  makeDocument(json, sizeof(json), "2026-10-22", many, 23, 1);
+  failures += expect(!node.updatePrices(json, summary), "accepted: 23 prices");
+
+  failures += expect(!planner.hasPrices(dayAfter), "prices of a rejected document kept");
+  failures += expect(sameCosts(planner, reference), "costs changed by a rejected document");
+
+  printf("prices of TariffNode: %d failures\n", failures);
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/**
+ * Host benchmark of the temperature arithmetic of one rule evaluation.
+ *
+ * Compares the former float code path with the fixed-point one of
+ * src/Temperature.hpp. One evaluation converts two DS18B20 raw readings,
+ * runs the solar decision of RuleAuto and formats the two temperatures and
+ * three settings for publishing.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=gnu++11 -O2 -Isrc bench/temperature_bench.cpp -o temperature_bench && ./temperature_bench
+ *
+ * Retired instructions are counted with perf_event_open (Linux); where that is
+ * not permitted the column shows n/a. Both code paths parse the settings once,
+ * like handleInput() does, so only the per-evaluation work is measured. The
+ * host has an FPU, the ESP8266 emulates every float operation in software, so
+ * the gap on the target is larger than shown here.
+ */
+
+#include "Temperature.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const int ROUNDS = 200000;
+
+volatile int sink;  // keeps the compiler from dropping the work
+
+/**
+ * Settings of the former code path, parsed once with String::toFloat() in handleInput().
+ */
+struct FloatSettings {
+  float poolMax;
+  float solarMin;
+  float hysteresis;
+};
+
+/**
+ * Former code path: float degrees, thresholds computed on every comparison.
+ */
+static bool evaluateFloat(const int32_t poolRaw, const int32_t solarRaw, const bool solarOn, const FloatSettings& s) {
+  const float pool       = poolRaw * 0.0078125f;  // DallasTemperature::getTempC()
+  const float solar      = solarRaw * 0.0078125f;
+  const float poolMax    = s.poolMax;
+  const float solarMin   = s.solarMin;
+  const float hysteresis = s.hysteresis;
+
+  bool on = solarOn;
+  if (solarOn) {
+    if (solar < solarMin - hysteresis || pool >= solar + hysteresis || pool >= poolMax + hysteresis) {
+      on = false;
+    }
+  } else if (pool <= poolMax && pool <= solar && solarMin <= solar) {
+    on = true;
+  }
+
+  char buffer[16];  // String(float) for the published values
+  snprintf(buffer, sizeof(buffer), "%.2f", pool);
+  snprintf(buffer, sizeof(buffer), "%.2f", solar);
+  snprintf(buffer, sizeof(buffer), "%.2f", poolMax);
+  snprintf(buffer, sizeof(buffer), "%.2f", solarMin);
+  snprintf(buffer, sizeof(buffer), "%.2f", hysteresis);
+  sink = buffer[0];
+
+  return on;
+}
+
+/**
+ * Fixed-point code path: settings parsed and thresholds derived once, outside the evaluation.
+ */
+static bool evaluateFixed(const int32_t poolRaw, const int32_t solarRaw, const bool solarOn, const TemperatureThresholds& t) {
+  const int16_t pool  = centiFromRaw(poolRaw);
+  const int16_t solar = centiFromRaw(solarRaw);
+
+  bool on = solarOn;
+  if (solarOn) {
+    if (solar < t.solarMinOff || pool - solar >= t.hysteresis || pool >= t.poolMaxOff) {
+      on = false;
+    }
+  } else if (pool <= t.poolMax && pool <= solar && t.solarMin <= solar) {
+    on = true;
+  }
+
+  char buffer[8];
+  formatCentiDegrees(pool, buffer);
+  formatCentiDegrees(solar, buffer);
+  formatCentiDegrees(t.poolMax, buffer);
+  formatCentiDegrees(t.solarMin, buffer);
+  formatCentiDegrees(t.hysteresis, buffer);
+  sink = buffer[0];
+
+  return on;
+}
+
+/**
+ * Retired user space instructions, -1 if the counter is not available.
+ */
+class InstructionCounter {
+
+public:
+  InstructionCounter() : _fd(-1) {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    _fd                 = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  void start() {
+#ifdef __linux__
+    if (_fd >= 0) {
+      ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  long long stop() {
+    long long count = -1;
+#ifdef __linux__
+    if (_fd >= 0) {
+      ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(_fd, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+      }
+    }
+#endif
+    return count;
+  }
+
+private:
+  int _fd;
+};
+
+struct Result {
+  double    nanoseconds;   // per evaluation
+  long long instructions;  // per evaluation, -1 if unknown
+};
+
+template <typename Evaluate>
+static Result measure(InstructionCounter& counter, Evaluate evaluate) {
+  const auto begin = std::chrono::steady_clock::now();
+  counter.start();
+
+  int  switches = 0;
+  bool on       = false;
+  for (int i = 0; i < ROUNDS; i++) {
+    const int32_t poolRaw  = 3200 + (i % 640);   // 25..30 °C
+    const int32_t solarRaw = 3200 + (i % 4480);  // 25..60 °C
+    const bool    next     = evaluate(poolRaw, solarRaw, on);
+    switches += (next != on);
+    on = next;
+  }
+
+  const long long instructions = counter.stop();
+  const auto      end          = std::chrono::steady_clock::now();
+  sink                         = switches;
+
+  Result result;
+  result.nanoseconds  = std::chrono::duration<double, std::nano>(end - begin).count() / ROUNDS;
+  result.instructions = (instructions >= 0) ? instructions / ROUNDS : -1;
+  return result;
+}
+
+/**
+ * One row of the result table, "n/a" for instructions the counter could not count.
+ */
+static void printResult(const char* name, const Result& result) {
+  if (result.instructions >= 0) {
+    printf("%-12s %14.1f %14lld\n", name, result.nanoseconds, result.instructions);
+  } else {
+    printf("%-12s %14.1f %14s\n", name, result.nanoseconds, "n/a");
+  }
+}
+
+int main() {
+  const char* poolMaxText    = "28.5";
+  const char* solarMinText   = "55";
+  const char* hysteresisText = "1.0";
+
+  // both paths parse the settings once, outside of the measurement
+  const FloatSettings   s = {(float)atof(poolMaxText), (float)atof(solarMinText), (float)atof(hysteresisText)};
+  TemperatureThresholds t = makeThresholds(0, 0, 0);
+  int16_t               poolMax, solarMin, hysteresis;
+  if (!parseCentiDegrees(poolMaxText, poolMax) || !parseCentiDegrees(solarMinText, solarMin) ||
+      !parseCentiDegrees(hysteresisText, hysteresis)) {
+    printf("settings not parsed\n");
+    return 1;
+  }
+  t = makeThresholds(poolMax, solarMin, hysteresis);
+
+  // both paths must decide the same
+  int mismatches = 0;
+  for (int32_t poolRaw = 0; poolRaw < 8000; poolRaw += 7) {
+    for (int32_t solarRaw = 0; solarRaw < 12800; solarRaw += 13) {
+      for (int solarOn = 0; solarOn < 2; solarOn++) {
+        if (evaluateFloat(poolRaw, solarRaw, solarOn, s) !=
+            evaluateFixed(poolRaw, solarRaw, solarOn, t)) {
+          mismatches++;
+        }
+      }
+    }
+  }
+
+  InstructionCounter counter;
+  const Result       floatResult = measure(counter, [&](int32_t pool, int32_t solar, bool on) {
+    return evaluateFloat(pool, solar, on, s);
+  });
+  const Result       fixedResult = measure(counter, [&](int32_t pool, int32_t solar, bool on) {
+    return evaluateFixed(pool, solar, on, t);
+  });
+
+  printf("decision mismatches: %d\n", mismatches);
+  printf("%-12s %14s %14s\n", "", "ns/eval", "instr/eval");
+  printResult("float", floatResult);
+  printResult("fixed-point", fixedResult);
+  if (floatResult.instructions > 0 && fixedResult.instructions > 0) {
+    printf("instruction reduction: %.1f %%\n",
+           100.0 * (floatResult.instructions - fixedResult.instructions) / floatResult.instructions);
+  }
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+"""
+Load test of the local HTTP API of the controller.
+
+Several clients request the API endpoints as fast as they can for a while;
+requests per second, latencies and status codes are reported. Meanwhile
+/api/heap is polled every few seconds for free heap and largest free block,
+so a leak or growing fragmentation under load shows up in the heap rows.
+/api/heap takes no stream buffer, so the polls do not compete with the
+clients; polls which fail anyway are counted and reported.
+
+    python3 scripts/http_load_test.py 192.168.178.20 --clients 4 --duration 60
+
+503 responses are expected once more clients than stream buffers
+(HttpApi::MAX_STREAMS) are active; the heap must stay flat anyway.
+"""
+import argparse
+import http.client
+import json
+import threading
+import time
+
+PATHS = ["/api/state", "/api/history"]
+
+
+def request(host, port, path, timeout):
+    """One GET; returns status (0 on a connection error) and latency in ms."""
+    start = time.monotonic()
+    try:
+        connection = http.client.HTTPConnection(host, port, timeout=timeout)
+        connection.request("GET", path)
+        response = connection.getresponse()
+        body = response.read()
+        status = response.status
+        connection.close()
+        if status == 200:
+            json.loads(body)
+    except (OSError, http.client.HTTPException, ValueError):
+        status = 0
+    return status, (time.monotonic() - start) * 1000
+
+
+def client(args, deadline, results, lock):
+    local = []
+    i = 0
+    while time.monotonic() < deadline:
+        path = PATHS[i % len(PATHS)] if args.path is None else args.path
+        local.append(request(args.host, args.port, path, args.timeout))
+        i += 1
+    with lock:
+        results.extend(local)
+
+
+def heap_monitor(args, deadline, samples, failures):
+    while time.monotonic() < deadline:
+        try:
+            connection = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            connection.request("GET", "/api/heap")
+            response = connection.getresponse()
+            body = response.read()
+            connection.close()
+            if response.status == 200:
+                heap = json.loads(body)
+                samples.append((time.monotonic(), heap["free-heap"], heap["max-block"]))
+            else:
+                failures[response.status] = failures.get(response.status, 0) + 1
+        except (OSError, http.client.HTTPException, ValueError, KeyError):
+            failures[0] = failures.get(0, 0) + 1
+        time.sleep(args.heap_interval)
+
+
+def percentile(values, share):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * share))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--duration", type=float, default=30, help="in s")
+    parser.add_argument("--path", help="only this path instead of all endpoints")
+    parser.add_argument("--timeout", type=float, default=5, help="per request in s")
+    parser.add_argument("--heap-interval", type=float, default=2, help="in s")
+    args = parser.parse_args()
+
+    deadline = time.monotonic() + args.duration
+    results = []
+    samples = []
+    failures = {}
+    lock = threading.Lock()
+
+    threads = [threading.Thread(target=client, args=(args, deadline, results, lock)) for _ in range(args.clients)]
+    threads.append(threading.Thread(target=heap_monitor, args=(args, deadline, samples, failures)))
+    start = time.monotonic()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.monotonic() - start
+
+    statuses = {}
+    for status, _ in results:
+        statuses[status] = statuses.get(status, 0) + 1
+    latencies = [latency for status, latency in results if status == 200]
+
+    print("requests   %d in %.1f s: %.1f/s, %.1f/s ok" %
+          (len(results), elapsed, len(results) / elapsed, len(latencies) / elapsed))
+    print("status     %s" % ", ".join("%s: %d" % (status or "error", count) for status, count in sorted(statuses.items())))
+    print("latency    p50 %.0f ms, p99 %.0f ms, max %.0f ms" %
+          (percentile(latencies, 0.5), percentile(latencies, 0.99), max(latencies or [0])))
+
+    if samples:
+        heap = [free for _, free, _ in samples]
+        block = [largest for _, _, largest in samples]
+        print("free heap  first %d, last %d, min %d B" % (heap[0], heap[-1], min(heap)))
+        print("max block  first %d, last %d, min %d B" % (block[0], block[-1], min(block)))
+    else:
+        print("heap       no samples")
+    if failures:
+        print("heap polls %d failed: %s" % (sum(failures.values()),
+              ", ".join("%s: %d" % (status or "error", count) for status, count in sorted(failures.items()))))
+
+
+if __name__ == "__main__":
+    main()
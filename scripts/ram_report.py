@@ -0,0 +1,160 @@
+"""
+RAM report of the nodes, run by PlatformIO after linking (extra_scripts).
+
+Lists per node class and per global singleton (scheduler, history, ...) the
+size of its instances and of its static members (string tables, ...), split
+into RAM and flash. The report of the previous build is kept in the build
+directory, so the second column shows what a change saved or cost.
+"""
+import json
+import os
+import re
+import subprocess
+
+Import("env")  # noqa: F821
+
+# DRAM of the ESP8266 and ESP32, everything else is flash or IRAM
+RAM_START = 0x3FF00000
+RAM_END = 0x40000000
+
+
+def site_header(project_dir, env):
+    """Topology header of the build, see src/Topology.hpp."""
+    for define in env.get("CPPDEFINES", []):
+        if isinstance(define, (list, tuple)) and define[0] == "SITE_TOPOLOGY":
+            return os.path.join(project_dir, "src", str(define[1]).strip('\\"'))
+    return os.path.join(project_dir, "src", "SiteDefault.hpp")
+
+
+def table_entries(header, table, platform):
+    """Entries of a topology table, one per line, in the #ifdef branch of the platform; None if not found."""
+    active = True
+    branches = []  # per #if: active before it, a branch was taken
+    entries = None
+    with open(header) as source:
+        for line in source:
+            line = line.strip()
+            if line.startswith("#if"):
+                taken = (platform in line) != line.startswith("#ifndef")
+                branches.append((active, taken))
+                active = active and taken
+            elif line.startswith("#elif"):
+                outer, taken = branches[-1]
+                active = outer and not taken and platform in line
+                branches[-1] = (outer, taken or active)
+            elif line.startswith("#else"):
+                outer, taken = branches[-1]
+                active = outer and not taken
+                branches[-1] = (outer, True)
+            elif line.startswith("#endif"):
+                active = branches.pop()[0]
+            elif active and re.match(r".*\b%s\[\]\s*=" % table, line):
+                entries = 0
+            elif active and entries is not None and line.startswith("{"):
+                entries += 1
+            elif active and entries is not None and line.startswith("};"):
+                return entries
+    return None
+
+
+def array_size(project_dir, env, size, main):
+    """Value of the size of a NodeArray: a number or a count like SENSOR_COUNT = sizeof(SENSORS) / ..."""
+    if size.isdigit():
+        return int(size)
+    match = re.search(r"^const\s+size_t\s+%s\s*=\s*sizeof\((\w+)\)" % size, main, re.MULTILINE)
+    platform = "ESP32" if env.get("PIOPLATFORM") == "espressif32" else "ESP8266"
+    entries = table_entries(site_header(project_dir, env), match.group(1), platform) if match else None
+    if not entries:
+        print("ram_report: size %s not found, counted as one node" % size)
+        return 1
+    return entries
+
+
+def instances(project_dir, env):
+    """Global objects defined in main.cpp or declared extern in a header: name -> (class, number of nodes)."""
+    result = {}
+    source_dir = os.path.join(project_dir, "src")
+    with open(os.path.join(source_dir, "main.cpp")) as source:
+        main = source.read()
+    for match in re.finditer(r"^NodeArray<(\w+),\s*(\w+)>\s+(\w+)", main, re.MULTILINE):
+        result[match.group(3)] = (match.group(1), array_size(project_dir, env, match.group(2), main))
+    patterns = {"main.cpp": re.compile(r"^([A-Z]\w+)\s+(\w+)\s*[(;]")}
+    for header in sorted(os.listdir(source_dir)):
+        if header.endswith(".hpp"):
+            patterns[header] = re.compile(r"^extern\s+([A-Z]\w+)\s+(\w+)\s*;")
+    for file, pattern in patterns.items():
+        with open(os.path.join(source_dir, file)) as source:
+            for line in source:
+                match = pattern.match(line)
+                if match:
+                    result[match.group(2)] = (match.group(1), 1)
+    return result
+
+
+def symbols(nm, elf):
+    """Defined data symbols: (name, address, size)."""
+    output = subprocess.check_output([nm, "-C", "-S", "--defined-only", elf]).decode()
+    for line in output.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in "bBdDrR":
+            yield parts[3], int(parts[0], 16), int(parts[1], 16)
+
+
+def collect(nm, elf, objects):
+    report = {}
+    classes = set(node for node, _ in objects.values())
+    for name, address, size in symbols(nm, elf):
+        if name in objects:
+            node, kind = objects[name][0], "instances"
+        elif "::" in name and name.split("::")[0] in classes:
+            node, kind = name.split("::")[0], "static"
+        elif name.startswith("c") and name[1:2].isupper():
+            node, kind = "NodeStrings", "static"
+        else:
+            continue
+        where = "ram" if RAM_START <= address < RAM_END else "flash"
+        entry = report.setdefault(node, {"count": 0, "instances": 0, "static ram": 0, "static flash": 0})
+        if kind == "instances":
+            entry["count"] += objects[name][1]
+            entry["instances"] += size
+        else:
+            entry["static " + where] += size
+    return report
+
+
+def print_report(report, previous):
+    columns = ["count", "instances", "static ram", "static flash"]
+    print("\nRAM report (bytes, change to previous build in brackets)")
+    print("%-24s" % "class" + "".join("%18s" % c for c in columns) + "%18s" % "ram per node")
+    for node in sorted(report):
+        entry = report[node]
+        old = previous.get(node, entry)
+        cells = []
+        for c in columns:
+            delta = entry[c] - old.get(c, 0)
+            cells.append("%18s" % ("%d (%+d)" % (entry[c], delta) if delta else entry[c]))
+        per_node = entry["instances"] // entry["count"] if entry["count"] else 0
+        old_per_node = old["instances"] // old["count"] if old.get("count") else per_node
+        delta = per_node - old_per_node
+        cells.append("%18s" % ("%d (%+d)" % (per_node, delta) if delta else per_node))
+        print("%-24s" % node + "".join(cells))
+    print("")
+
+
+def ram_report(source, target, env):
+    elf = str(target[0])
+    nm = env.subst("$CC").replace("gcc", "nm")
+    file = os.path.join(env.subst("$BUILD_DIR"), "ram_report.json")
+
+    report = collect(nm, elf, instances(env.subst("$PROJECT_DIR"), env))
+    previous = {}
+    if os.path.exists(file):
+        with open(file) as old:
+            previous = json.load(old)
+
+    print_report(report, previous)
+    with open(file, "w") as new:
+        json.dump(report, new, indent=2)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_report)  # noqa: F821
@@ -0,0 +1,97 @@
+/**
+ * Timestamps of the boot phases.
+ */
+#include "BootProfile.hpp"
+
+BootProfile bootProfile;
+
+#ifdef ESP32
+// kept by a reset, random after power on
+RTC_NOINIT_ATTR uint32_t rtcBootRecord[2 + BOOT_PHASES];
+#elif defined(ESP8266)
+// in 4 byte blocks; the first 128 bytes are used by OTA, Homie uses a few blocks after them
+const uint32_t RTC_BOOT_OFFSET = 96;
+#endif
+
+/**
+ *
+ */
+BootProfile::BootProfile() {
+  memset(&_record, 0, sizeof(_record));
+  memset(&_previous, 0, sizeof(_previous));
+  _hasPrevious = false;
+}
+
+/**
+ * Take over the record of the previous boot and start a new one. Call first thing in setup().
+ */
+void BootProfile::begin() {
+  _hasPrevious = readRtc(&_previous);
+
+  _record.magic     = MAGIC;
+  _record.bootCount = _hasPrevious ? _previous.bootCount + 1 : 1;
+  memset(_record.phases, 0, sizeof(_record.phases));
+
+  mark(BOOT_SETUP);
+}
+
+/**
+ *
+ */
+void BootProfile::mark(const BootPhase phase) {
+  if (phase >= BOOT_PHASES || _record.phases[phase] != 0) {
+    return;
+  }
+
+  // 0 means "not reached"
+  _record.phases[phase] = millis() | 1;
+  writeRtc();
+}
+
+/**
+ *
+ */
+const char* BootProfile::getPhaseName(const BootPhase phase) {
+  switch (phase) {
+    case BOOT_SETUP:
+      return "setup";
+    case BOOT_RELAYS:
+      return "relays";
+    case BOOT_SENSORS:
+      return "sensors";
+    case BOOT_NETWORK:
+      return "network";
+    case BOOT_CONTROL:
+      return "control";
+    case BOOT_MQTT:
+      return "mqtt";
+    default:
+      return "";
+  }
+}
+
+/**
+ *
+ */
+bool BootProfile::readRtc(Record* record) {
+#ifdef ESP32
+  memcpy(record, rtcBootRecord, sizeof(Record));
+#elif defined(ESP8266)
+  if (!ESP.rtcUserMemoryRead(RTC_BOOT_OFFSET, (uint32_t*)record, sizeof(Record))) {
+    return false;
+  }
+#endif
+
+  return record->magic == MAGIC;
+}
+
+/**
+ *
+ */
+void BootProfile::writeRtc() {
+#ifdef ESP32
+  memcpy(rtcBootRecord, &_record, sizeof(Record));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryWrite(RTC_BOOT_OFFSET, (uint32_t*)&_record, sizeof(Record));
+#endif
+}
@@ -0,0 +1,55 @@
+/**
+ * Timestamps of the boot phases.
+ *
+ * The record lives in RTC memory, which survives a reset but not a power
+ * cycle: after a crash or watchdog reset during boot the phases reached by
+ * the previous boot are still available and published with the current ones.
+ * Times are millis() since the start of the firmware.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+enum BootPhase : uint8_t {
+  BOOT_SETUP,    // setup() entered
+  BOOT_RELAYS,   // relays driven to their persisted state
+  BOOT_SENSORS,  // temperature sensors initialized
+  BOOT_NETWORK,  // configuration loaded, WiFi started
+  BOOT_CONTROL,  // rules wired, control running
+  BOOT_MQTT,     // MQTT connected
+  BOOT_PHASES
+};
+
+class BootProfile {
+
+public:
+  BootProfile();
+
+  void begin();
+  void mark(const BootPhase phase);
+
+  uint32_t           getBootCount() const { return _record.bootCount; }
+  uint32_t           get(const BootPhase phase) const { return _record.phases[phase]; }
+  uint32_t           getPrevious(const BootPhase phase) const { return _previous.phases[phase]; }
+  bool               hasPrevious() const { return _hasPrevious; }
+  static const char* getPhaseName(const BootPhase phase);
+
+private:
+  static const uint32_t MAGIC = 0x424F4F54;  // "BOOT"
+
+  struct Record {
+    uint32_t magic;
+    uint32_t bootCount;
+    uint32_t phases[BOOT_PHASES];  // in ms, 0 if not reached
+  };
+
+  Record _record;
+  Record _previous;
+  bool   _hasPrevious;
+
+  bool readRtc(Record* record);
+  void writeRtc();
+};
+
+extern BootProfile bootProfile;
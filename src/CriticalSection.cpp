@@ -0,0 +1,5 @@
+#include "CriticalSection.hpp"
+
+#ifdef ESP32
+portMUX_TYPE sharedDataMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
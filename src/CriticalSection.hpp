@@ -0,0 +1,31 @@
+/**
+ * Short critical section around data shared with the async web server.
+ *
+ * On the ESP32 the callbacks of the web server run in the task of AsyncTCP,
+ * concurrently to loop(). On the ESP8266 they run between two passes of
+ * loop(), there is nothing to lock.
+ *
+ * Keep the sections to a few copies: interrupts are disabled meanwhile.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef ESP32
+extern portMUX_TYPE sharedDataMux;
+#endif
+
+class CriticalSection {
+
+public:
+#ifdef ESP32
+  CriticalSection() { portENTER_CRITICAL(&sharedDataMux); }
+  ~CriticalSection() { portEXIT_CRITICAL(&sharedDataMux); }
+#else
+  CriticalSection() {}
+#endif
+
+  CriticalSection(const CriticalSection&) = delete;
+  CriticalSection& operator=(const CriticalSection&) = delete;
+};
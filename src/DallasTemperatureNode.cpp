@@ -18,12 +18,15 @@
  */
 #include "DallasTemperatureNode.hpp"
 
+const char DallasTemperatureNode::cCaption[] PROGMEM = "• DallasTemperature sensor:";
+
 DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, const uint8_t pin, const int measurementInterval)
     : HomieNode(id, name, "temperature") {
 
   _pin                 = pin;
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = 0;
+  _measurementTask     = DeadlineScheduler::INVALID_TASK;
+  numberOfDevices      = 0;
 
   oneWire.begin(_pin);
   sensor.setOneWire(&oneWire);
@@ -32,15 +35,45 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
 /**
  *
  */
-void DallasTemperatureNode::setup() {
+void DallasTemperatureNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.setInterval(_measurementTask, _measurementInterval * 1000UL);
+}
 
-  advertise(cHomieNodeState).setName(cHomieNodeStateName);
-  advertise(cTemperature).setName(cTemperatureName).setDatatype("float").setUnit(cTemperatureUnit);
+/**
+ * Search the bus for sensors. Called by setup(), or earlier during boot.
+ */
+void DallasTemperatureNode::begin() {
+  if (_begun) {
+    return;
+  }
+  _begun = true;
 
   // Start up the library
   sensor.begin();
   // set global resolution to 9, 10, 11, or 12 bits
   //sensor.setResolution(12);
+
+  // measure without waiting for MQTT
+  numberOfDevices = sensor.getDeviceCount();
+
+#if SENSOR_TASK
+  // the sensor task sleeps during the conversion instead of polling the bus
+  sensor.setWaitForConversion(false);
+#endif
+}
+
+/**
+ *
+ */
+void DallasTemperatureNode::setup() {
+
+  advertise(cHomieNodeState).setName(cHomieNodeStateName);
+  advertise(cTemperature).setName(cTemperatureName).setDatatype("float").setUnit(cTemperatureUnit);
+
+  begin();
+
+  _measurementTask = scheduler.addPeriodic(getId(), measureTask, this, _measurementInterval * 1000UL);
 }
 
 /**
@@ -48,23 +81,28 @@ void DallasTemperatureNode::setup() {
  */
 void DallasTemperatureNode::onReadyToOperate() {
 
+#if !SENSOR_TASK
   // Grab a count of devices on the wire
   numberOfDevices = sensor.getDeviceCount();
+#endif
   // report parasite power requirements
-  Homie.getLogger() << cIndent << F("Parasite power is: ") << sensor.isParasitePowerMode() << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("Parasite power is: ") << sensor.isParasitePowerMode() << endl;
 
   if (numberOfDevices > 0) {
-    Homie.getLogger() << cIndent << numberOfDevices << F(" devices found on PIN ") << _pin << endl;
+    Homie.getLogger() << FPSTR(cIndent) << numberOfDevices << F(" devices found on PIN ") << _pin << endl;
 
+#if !SENSOR_TASK
     for (uint8_t i = 0; i < numberOfDevices; i++) {
       // Search the wire for address
       DeviceAddress tempDeviceAddress;  // We'll use this variable to store a found device address
 
       if (sensor.getAddress(tempDeviceAddress, i)) {
         String adr = address2String(tempDeviceAddress);
-        Homie.getLogger() << cIndent << F("PIN ") << _pin << F(": ") << F("Device ") << i << F(" using address ") << adr << endl;
+        Homie.getLogger() << FPSTR(cIndent) << F("PIN ") << _pin << F(": ") << F("Device ") << i << F(" using address ") << adr
+                          << endl;
       }
     }
+#endif
   } else {
     Homie.getLogger() << F("✖ No sensors found on pin ") << _pin << endl;
     if (Homie.isConnected()) {
@@ -73,49 +111,116 @@ void DallasTemperatureNode::onReadyToOperate() {
   }
 }
 
+#if SENSOR_TASK
+/**
+ * Publish the latest reading of the sensor task.
+ */
+void DallasTemperatureNode::measure() {
+  if (_temperature == TEMPERATURE_INVALID) {
+    Homie.getLogger() << F("✖ No valid temperature: ") << getId() << endl;
+    if (Homie.isConnected()) {
+      setProperty(cHomieNodeState).send(cHomieNodeState_Error);
+    }
+    return;
+  }
+
+  Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;
+  sendTemperature();
+}
+
+/**
+ * Start the conversion of all sensors on the bus.
+ */
+void DallasTemperatureNode::requestConversion() {
+  if (numberOfDevices == 0) {
+    //retry to get
+    sensor.begin();
+    numberOfDevices = sensor.getDeviceCount();
+  }
+  if (numberOfDevices > 0) {
+    sensor.requestTemperatures();
+  }
+}
+
+/**
+ *
+ */
+unsigned long DallasTemperatureNode::getConversionTime() {
+  return sensor.millisToWaitForConversion(sensor.getResolution());
+}
+
+/**
+ * Temperature of the last sensor on the bus with a valid reading, TEMPERATURE_INVALID if none.
+ */
+int16_t DallasTemperatureNode::readConversion() {
+  int16_t temperature = TEMPERATURE_INVALID;
+
+  for (uint8_t i = 0; i < numberOfDevices; i++) {
+    DeviceAddress tempDeviceAddress;
+    if (sensor.getAddress(tempDeviceAddress, i)) {
+      const int32_t raw = sensor.getTemp(tempDeviceAddress);
+      if (raw != DEVICE_DISCONNECTED_RAW) {
+        temperature = centiFromRaw(raw);
+      }
+    }
+  }
+
+  return temperature;
+}
+
+#else
 /**
  *
  */
-void DallasTemperatureNode::loop() {
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-    _lastMeasurement = millis();
-
-    if (numberOfDevices > 0) {
-      Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;
-      // call sensors.requestTemperatures() to issue a global temperature
-      // request to all devices on the bus
-      sensor.requestTemperatures();  // Send the command to get temperature readings
-      for (uint8_t i = 0; i < numberOfDevices; i++) {
-        uint8_t cnt = 0;
-
-        DeviceAddress tempDeviceAddress;
-        if (sensor.getAddress(tempDeviceAddress, i)) {
-
-          _temperature = sensor.getTempC(tempDeviceAddress);
-          if (DEVICE_DISCONNECTED_C == _temperature) {
-            Homie.getLogger() << cIndent << F("✖ Error reading sensor. Request count: ") << cnt << endl;
-            if (Homie.isConnected()) {
-              setProperty(cHomieNodeState).send(cHomieNodeState_Error);
-            }
-          } else {
-            Homie.getLogger() << cIndent << F("Temperature=") << _temperature << endl;
-
-            if (Homie.isConnected()) {
-              setProperty(cTemperature).send(String(_temperature));
-              setProperty(cHomieNodeState).send(cHomieNodeState_OK);
-            }
+void DallasTemperatureNode::measure() {
+  if (numberOfDevices > 0) {
+    Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;
+    // call sensors.requestTemperatures() to issue a global temperature
+    // request to all devices on the bus
+    sensor.requestTemperatures();  // Send the command to get temperature readings
+    for (uint8_t i = 0; i < numberOfDevices; i++) {
+      uint8_t cnt = 0;
+
+      DeviceAddress tempDeviceAddress;
+      if (sensor.getAddress(tempDeviceAddress, i)) {
+
+        // raw counts, no float conversion in the library
+        const int32_t raw = sensor.getTemp(tempDeviceAddress);
+        if (DEVICE_DISCONNECTED_RAW == raw) {
+          _temperature = TEMPERATURE_INVALID;
+          Homie.getLogger() << FPSTR(cIndent) << F("✖ Error reading sensor. Request count: ") << cnt << endl;
+          if (Homie.isConnected()) {
+            setProperty(cHomieNodeState).send(cHomieNodeState_Error);
           }
+        } else {
+          _temperature = centiFromRaw(raw);
+          sendTemperature();
         }
       }
-    } else {
+    }
+  } else {
 
-      Homie.getLogger() << F("No Sensor found!") << endl;
-      if (Homie.isConnected()) {
-        setProperty(cHomieNodeState).send(cHomieNodeState_Error);
-      }
-      //retry to get
-      numberOfDevices = sensor.getDeviceCount();
+    Homie.getLogger() << F("No Sensor found!") << endl;
+    if (Homie.isConnected()) {
+      setProperty(cHomieNodeState).send(cHomieNodeState_Error);
     }
+    //retry to get
+    numberOfDevices = sensor.getDeviceCount();
+  }
+}
+#endif
+
+/**
+ *
+ */
+void DallasTemperatureNode::sendTemperature() {
+  char buffer[8];
+  formatCentiDegrees(_temperature, buffer);
+
+  Homie.getLogger() << FPSTR(cIndent) << F("Temperature=") << buffer << endl;
+  if (Homie.isConnected()) {
+    setProperty(cTemperature).send(buffer);
+    setProperty(cHomieNodeState).send(cHomieNodeState_OK);
   }
 }
 
@@ -123,7 +228,7 @@ void DallasTemperatureNode::loop() {
  *
  */
 void DallasTemperatureNode::printCaption() {
-  Homie.getLogger() << cCaption << endl;
+  Homie.getLogger() << FPSTR(cCaption) << endl;
 }
 
 /**
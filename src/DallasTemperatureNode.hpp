@@ -8,6 +8,10 @@
 #include <Homie.hpp>
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include "DeadlineScheduler.hpp"
+#include "SensorTask.hpp"
+#include "NodeStrings.hpp"
+#include "Temperature.hpp"
 
 class DallasTemperatureNode : public HomieNode {
 
@@ -15,14 +19,22 @@ public:
   DallasTemperatureNode(const char* id, const char* name, const uint8_t pin,
                         const int measurementInterval = MEASUREMENT_INTERVAL);
 
+  void          begin();
   uint8_t       getPin() const { return _pin; }
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
-  float         getTemperature() const { return _temperature; }
+  int16_t       getTemperature() const { return _temperature; }  // centi-degrees, TEMPERATURE_INVALID if unknown
+
+#if SENSOR_TASK
+  // bus access from the sensor task only
+  void          requestConversion();
+  unsigned long getConversionTime();
+  int16_t       readConversion();
+  void          setTemperature(const int16_t temperature) { _temperature = temperature; }
+#endif
 
 protected:
   void setup() override;
-  void loop() override;
   void onReadyToOperate() override;
 
 private:
@@ -30,31 +42,24 @@ private:
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
 
-  const char* cCaption = "• DallasTemperature sensor:";
-  const char* cIndent  = "  ◦ ";
-
-  const char* cTemperature     = "temperature";
-  const char* cTemperatureName = "Temperature";
-  const char* cTemperatureUnit = "°C";
-
-  const char* cHomieNodeState     = "state";
-  const char* cHomieNodeStateName = "State";
-
-  const char* cHomieNodeState_OK    = "OK";
-  const char* cHomieNodeState_Error = "Error";
+  static const char cCaption[];
 
   bool _sensorFound = false;
+  bool _begun       = false;
 
   uint8_t       _pin;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
+  int8_t        _measurementTask;
 
-  float _temperature = NAN;
+  int16_t _temperature = TEMPERATURE_INVALID;  // centi-degrees
 
   OneWire           oneWire;
   DallasTemperature sensor;
   uint8_t           numberOfDevices;  // Number of temperature devices found
 
-  void   printCaption();
+  void        measure();
+  static void measureTask(void* node) { static_cast<DallasTemperatureNode*>(node)->measure(); }
+  void        printCaption();
+  void        sendTemperature();
   String address2String(const DeviceAddress deviceAddress);
 };
@@ -0,0 +1,243 @@
+/**
+ * Central scheduler of all periodic and one-shot work.
+ */
+#include "DeadlineScheduler.hpp"
+#include <limits.h>
+#include <Homie.hpp>
+#include "NodeStrings.hpp"
+
+DeadlineScheduler scheduler;
+
+/**
+ *
+ */
+DeadlineScheduler::DeadlineScheduler() {
+  _taskCount = 0;
+  _heapSize  = 0;
+}
+
+/**
+ * Run callback every interval ms, the first time after firstDelay ms.
+ * Returns the task id or INVALID_TASK if the task table is full.
+ */
+int8_t DeadlineScheduler::addPeriodic(const char* name, SchedulerCallback callback, void* context, const unsigned long interval,
+                                      const unsigned long firstDelay) {
+  return addTask(name, callback, context, (interval > 0) ? interval : 1, firstDelay);
+}
+
+/**
+ * Run callback once after delay ms. The task can be started again with trigger().
+ */
+int8_t DeadlineScheduler::addOneShot(const char* name, SchedulerCallback callback, void* context, const unsigned long delay) {
+  return addTask(name, callback, context, 0, delay);
+}
+
+/**
+ *
+ */
+int8_t DeadlineScheduler::addTask(const char* name, SchedulerCallback callback, void* context, const unsigned long interval,
+                                  const unsigned long delay) {
+  if (_taskCount >= MAX_TASKS) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ scheduler full, task ") << name << F(" does not run, raise MAX_TASKS") << endl;
+    return INVALID_TASK;
+  }
+
+  const int8_t task = _taskCount++;
+  _tasks[task].name     = name;
+  _tasks[task].callback = callback;
+  _tasks[task].context  = context;
+  _tasks[task].interval = interval;
+  _tasks[task].heapPos  = -1;
+  memset(&_tasks[task].statistics, 0, sizeof(SchedulerTaskStatistics));
+#if LOOP_PROFILER
+  _tasks[task].profileSlot = loopProfiler.addSlot(name, "loop");
+#endif
+
+  schedule(task, millis() + delay);
+  return task;
+}
+
+/**
+ * Change the interval of a periodic task; the next run is due one new interval after now.
+ */
+void DeadlineScheduler::setInterval(const int8_t task, const unsigned long interval) {
+  if (task < 0 || task >= _taskCount || interval == 0) {
+    return;
+  }
+
+  _tasks[task].interval = interval;
+  schedule(task, millis() + interval);
+}
+
+/**
+ * Run a task after delay ms, earlier than its regular deadline.
+ * A later regular deadline is replaced; periodic tasks continue with their interval from then on.
+ */
+void DeadlineScheduler::trigger(const int8_t task, const unsigned long delay) {
+  if (task < 0 || task >= _taskCount) {
+    return;
+  }
+
+  const unsigned long deadline = millis() + delay;
+  if (_tasks[task].heapPos < 0 || (long)(deadline - _tasks[task].deadline) < 0) {
+    schedule(task, deadline);
+  }
+}
+
+/**
+ *
+ */
+void DeadlineScheduler::cancel(const int8_t task) {
+  if (task >= 0 && task < _taskCount) {
+    unschedule(task);
+  }
+}
+
+/**
+ * Run all tasks which are due. Call on every pass of the main loop.
+ */
+void DeadlineScheduler::run() {
+  while (_heapSize > 0) {
+    const unsigned long now  = millis();
+    const int8_t        task = _heap[0];
+    Task&               t    = _tasks[task];
+
+    if ((long)(now - t.deadline) < 0) {
+      return;
+    }
+
+    SchedulerTaskStatistics& stats = t.statistics;
+    stats.runs++;
+    stats.lastLateness = now - t.deadline;
+    if (stats.lastLateness > stats.maxLateness) {
+      stats.maxLateness = stats.lastLateness;
+    }
+    if (stats.runs == 1) {
+      stats.avgLateness = stats.lastLateness;
+    } else {
+      stats.avgLateness += ((long)stats.lastLateness - (long)stats.avgLateness) / 8;
+    }
+
+    // reschedule before the callback, so it may trigger or cancel itself
+    if (t.interval > 0) {
+      unsigned long next = t.deadline + t.interval;
+      if ((long)(now - next) >= 0) {
+        // overrun: skip the missed runs instead of catching up
+        next = now + t.interval;
+      }
+      schedule(task, next);
+    } else {
+      unschedule(task);
+    }
+
+    PROFILE_SCOPE(t.profileSlot);
+    t.callback(t.context);
+  }
+}
+
+/**
+ * Milliseconds until the next task is due, 0 if one is due now.
+ */
+unsigned long DeadlineScheduler::getIdleTime() const {
+  if (_heapSize == 0) {
+    return ULONG_MAX;
+  }
+
+  const long remaining = (long)(_tasks[_heap[0]].deadline - millis());
+  return (remaining > 0) ? remaining : 0;
+}
+
+/**
+ *
+ */
+void DeadlineScheduler::resetStatistics() {
+  for (uint8_t i = 0; i < _taskCount; i++) {
+    memset(&_tasks[i].statistics, 0, sizeof(SchedulerTaskStatistics));
+  }
+}
+
+/**
+ * Insert the task into the heap or move it to its new deadline.
+ */
+void DeadlineScheduler::schedule(const int8_t task, const unsigned long deadline) {
+  const bool movedLater = (_tasks[task].heapPos >= 0) && (long)(deadline - _tasks[task].deadline) >= 0;
+  _tasks[task].deadline = deadline;
+
+  if (_tasks[task].heapPos < 0) {
+    _heap[_heapSize]     = task;
+    _tasks[task].heapPos = _heapSize;
+    _heapSize++;
+    siftUp(_tasks[task].heapPos);
+  } else if (movedLater) {
+    siftDown(_tasks[task].heapPos);
+  } else {
+    siftUp(_tasks[task].heapPos);
+  }
+}
+
+/**
+ *
+ */
+void DeadlineScheduler::unschedule(const int8_t task) {
+  const int8_t pos = _tasks[task].heapPos;
+  if (pos < 0) {
+    return;
+  }
+
+  _heapSize--;
+  if (pos != _heapSize) {
+    swap(pos, _heapSize);
+    siftDown(pos);
+    siftUp(pos);
+  }
+  _tasks[task].heapPos = -1;
+}
+
+/**
+ *
+ */
+void DeadlineScheduler::swap(const uint8_t i, const uint8_t j) {
+  const int8_t task = _heap[i];
+  _heap[i]          = _heap[j];
+  _heap[j]          = task;
+
+  _tasks[_heap[i]].heapPos = i;
+  _tasks[_heap[j]].heapPos = j;
+}
+
+/**
+ *
+ */
+void DeadlineScheduler::siftUp(uint8_t pos) {
+  while (pos > 0) {
+    const uint8_t parent = (pos - 1) / 2;
+    if (!earlier(_heap[pos], _heap[parent])) {
+      return;
+    }
+    swap(pos, parent);
+    pos = parent;
+  }
+}
+
+/**
+ *
+ */
+void DeadlineScheduler::siftDown(uint8_t pos) {
+  while (true) {
+    const uint8_t left     = 2 * pos + 1;
+    const uint8_t right    = left + 1;
+    uint8_t       smallest = pos;
+
+    if (left < _heapSize && earlier(_heap[left], _heap[smallest])) {
+      smallest = left;
+    }
+    if (right < _heapSize && earlier(_heap[right], _heap[smallest])) {
+      smallest = right;
+    }
+    if (smallest == pos) {
+      return;
+    }
+    swap(pos, smallest);
+    pos = smallest;
+  }
+}
@@ -0,0 +1,83 @@
+/**
+ * Central scheduler of all periodic and one-shot work.
+ *
+ * Tasks are kept in a min-heap ordered by their next deadline, so run() only
+ * looks at the head of the heap and getIdleTime() tells the main loop how long
+ * nothing is due. Each task records how late it started compared to its
+ * deadline (jitter).
+ *
+ * Deadlines are millis() values compared by signed difference, which is safe
+ * across the 49 day wrap-around.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "LoopProfiler.hpp"
+
+typedef void (*SchedulerCallback)(void* context);
+
+/**
+ * Start delay statistics of a task, in ms.
+ */
+struct SchedulerTaskStatistics {
+  uint32_t runs;
+  uint32_t lastLateness;
+  uint32_t maxLateness;
+  uint32_t avgLateness;  // exponential moving average, weight 1/8
+};
+
+class DeadlineScheduler {
+
+public:
+  static const uint8_t MAX_TASKS    = 20;
+  static const int8_t  INVALID_TASK = -1;
+
+  DeadlineScheduler();
+
+  int8_t addPeriodic(const char* name, SchedulerCallback callback, void* context, const unsigned long interval,
+                     const unsigned long firstDelay = 0);
+  int8_t addOneShot(const char* name, SchedulerCallback callback, void* context, const unsigned long delay);
+
+  void setInterval(const int8_t task, const unsigned long interval);
+  void trigger(const int8_t task, const unsigned long delay = 0);
+  void cancel(const int8_t task);
+
+  void          run();
+  unsigned long getIdleTime() const;
+
+  uint8_t                        getTaskCount() const { return _taskCount; }
+  const char*                    getTaskName(const int8_t task) const { return _tasks[task].name; }
+  const SchedulerTaskStatistics& getStatistics(const int8_t task) const { return _tasks[task].statistics; }
+  void                           resetStatistics();
+
+private:
+  struct Task {
+    const char*             name;
+    SchedulerCallback       callback;
+    void*                   context;
+    unsigned long           interval;  // in ms, 0 for one-shot tasks
+    unsigned long           deadline;  // millis()
+    int8_t                  heapPos;   // position in _heap, -1 if not scheduled
+    SchedulerTaskStatistics statistics;
+#if LOOP_PROFILER
+    int8_t profileSlot;
+#endif
+  };
+
+  Task    _tasks[MAX_TASKS];
+  int8_t  _heap[MAX_TASKS];
+  uint8_t _taskCount;
+  uint8_t _heapSize;
+
+  int8_t addTask(const char* name, SchedulerCallback callback, void* context, const unsigned long interval,
+                 const unsigned long delay);
+  bool   earlier(const int8_t a, const int8_t b) const { return (long)(_tasks[a].deadline - _tasks[b].deadline) < 0; }
+  void   schedule(const int8_t task, const unsigned long deadline);
+  void   unschedule(const int8_t task);
+  void   swap(const uint8_t i, const uint8_t j);
+  void   siftUp(uint8_t pos);
+  void   siftDown(uint8_t pos);
+};
+
+extern DeadlineScheduler scheduler;
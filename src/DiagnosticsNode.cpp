@@ -0,0 +1,242 @@
+/**
+ * Homie Node for runtime diagnostics of the controller.
+ *
+ */
+
+#include "DiagnosticsNode.hpp"
+
+const char DiagnosticsNode::cCaption[] PROGMEM = "• Diagnostics:";
+
+const char DiagnosticsNode::cScheduler[]         = "scheduler";
+const char DiagnosticsNode::cSchedulerName[]     = "Scheduler Jitter";
+const char DiagnosticsNode::cProfile[]           = "profile";
+const char DiagnosticsNode::cProfileName[]       = "Loop Latency";
+const char DiagnosticsNode::cBoot[]              = "boot";
+const char DiagnosticsNode::cBootName[]          = "Boot Phases";
+const char DiagnosticsNode::cFirstDecision[]     = "first-decision";
+const char DiagnosticsNode::cFirstDecisionName[] = "Time to First Control Decision";
+const char DiagnosticsNode::cFreeHeap[]          = "free-heap";
+const char DiagnosticsNode::cFreeHeapName[]      = "Free Heap";
+const char DiagnosticsNode::cMaxBlock[]          = "max-block";
+const char DiagnosticsNode::cMaxBlockName[]      = "Largest Free Block";
+const char DiagnosticsNode::cFragmentation[]     = "fragmentation";
+const char DiagnosticsNode::cFragmentationName[] = "Heap Fragmentation";
+const char DiagnosticsNode::cMinFreeHeap[]       = "min-free-heap";
+const char DiagnosticsNode::cMinFreeHeapName[]   = "Min. Free Heap";
+const char DiagnosticsNode::cHeapTrend[]         = "heap-trend";
+const char DiagnosticsNode::cHeapTrendName[]     = "Free Heap Trend";
+const char DiagnosticsNode::cStackFree[]         = "stack-free";
+const char DiagnosticsNode::cStackFreeName[]     = "Min. Free Stack";
+const char DiagnosticsNode::cPowerMode[]         = "power-mode";
+const char DiagnosticsNode::cPowerModeName[]     = "Power Mode";
+const char DiagnosticsNode::cDutyCycle[]         = "duty-cycle";
+const char DiagnosticsNode::cDutyCycleName[]     = "Duty Cycle";
+const char DiagnosticsNode::cCurrentDraw[]       = "current";
+const char DiagnosticsNode::cCurrentDrawName[]   = "Estimated Current";
+
+/**
+ *
+ */
+DiagnosticsNode::DiagnosticsNode(const char* id, const char* name, const int publishInterval)
+    : HomieNode(id, name, "diagnostics") {
+
+  _publishInterval   = (publishInterval > MIN_INTERVAL) ? publishInterval : MIN_INTERVAL;
+  _publishTask       = DeadlineScheduler::INVALID_TASK;
+  _length            = 0;
+  _operationModeNode = nullptr;
+  _bootPublished     = false;
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::setPublishInterval(unsigned long interval) {
+  _publishInterval = (interval > MIN_INTERVAL) ? interval : MIN_INTERVAL;
+  scheduler.setInterval(_publishTask, _publishInterval * 1000UL);
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::setup() {
+  advertise(cScheduler).setName(cSchedulerName).setDatatype("string");
+#if LOOP_PROFILER
+  advertise(cProfile).setName(cProfileName).setDatatype("string");
+#endif
+  advertise(cBoot).setName(cBootName).setDatatype("string");
+  advertise(cFirstDecision).setName(cFirstDecisionName).setDatatype("integer").setUnit("ms");
+  advertise(cFreeHeap).setName(cFreeHeapName).setDatatype("integer").setUnit("B");
+  advertise(cMaxBlock).setName(cMaxBlockName).setDatatype("integer").setUnit("B");
+  advertise(cFragmentation).setName(cFragmentationName).setDatatype("integer").setFormat("0:100").setUnit("%");
+  advertise(cMinFreeHeap).setName(cMinFreeHeapName).setDatatype("integer").setUnit("B");
+  advertise(cHeapTrend).setName(cHeapTrendName).setDatatype("integer").setUnit("B/h");
+  advertise(cStackFree).setName(cStackFreeName).setDatatype("integer").setUnit("B");
+  advertise(cPowerMode).setName(cPowerModeName).setDatatype("enum").setFormat("off,modem,light");
+  advertise(cDutyCycle).setName(cDutyCycleName).setDatatype("float").setFormat("0:100").setUnit("%");
+  advertise(cCurrentDraw).setName(cCurrentDrawName).setDatatype("float").setUnit("mA");
+
+  _publishTask = scheduler.addPeriodic(getId(), publishTask, this, _publishInterval * 1000UL, _publishInterval * 1000UL);
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::publish() {
+  if (!Homie.isConnected()) {
+    return;
+  }
+
+  Homie.getLogger() << F("〽 Sending Diagnostics: ") << getId() << endl;
+  if (!_bootPublished) {
+    publishBoot();
+  }
+  if (_operationModeNode != nullptr && _operationModeNode->getFirstDecisionTime() > 0) {
+    setProperty(cFirstDecision).send(String(_operationModeNode->getFirstDecisionTime()));
+  }
+  publishScheduler();
+  publishProfile();
+  publishPower();
+  publishHeap();
+}
+
+/**
+ * Boot phases in ms, once after boot, as JSON:
+ * {"count":n,"setup":ms,"relays":ms,...,"previous":{"setup":ms,...}}
+ * A phase missing in "previous" was not reached by the boot before the last reset.
+ */
+void DiagnosticsNode::publishBoot() {
+  beginJson();
+  appendJson("\"count\":%lu", (unsigned long)bootProfile.getBootCount());
+  for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+    const BootPhase phase = (BootPhase)i;
+    if (bootProfile.get(phase) > 0) {
+      appendJson(",\"%s\":%lu", BootProfile::getPhaseName(phase), (unsigned long)bootProfile.get(phase));
+    }
+  }
+  if (bootProfile.hasPrevious()) {
+    appendJson(",\"previous\":{");
+    bool first = true;
+    for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+      const BootPhase phase = (BootPhase)i;
+      if (bootProfile.getPrevious(phase) > 0) {
+        appendJson("%s\"%s\":%lu", first ? "" : ",", BootProfile::getPhaseName(phase),
+                   (unsigned long)bootProfile.getPrevious(phase));
+        first = false;
+      }
+    }
+    appendJson("}");
+  }
+  endJson();
+
+  setProperty(cBoot).send(_buffer);
+  _bootPublished = true;
+}
+
+/**
+ * Start delay of every task since the last publish, as JSON:
+ * {"<task>":{"runs":n,"avg":ms,"max":ms},...}
+ */
+void DiagnosticsNode::publishScheduler() {
+  beginJson();
+  for (uint8_t i = 0; i < scheduler.getTaskCount(); i++) {
+    const SchedulerTaskStatistics& stats = scheduler.getStatistics(i);
+
+    if (!appendJson("%s\"%s\":{\"runs\":%lu,\"avg\":%lu,\"max\":%lu}", (i > 0) ? "," : "", scheduler.getTaskName(i),
+                    (unsigned long)stats.runs, (unsigned long)stats.avgLateness, (unsigned long)stats.maxLateness)) {
+      break;
+    }
+  }
+  endJson();
+
+  setProperty(cScheduler).send(_buffer);
+  scheduler.resetStatistics();
+}
+
+/**
+ * Wall time of every profiled scope since the last publish, as JSON:
+ * {"<name>/<kind>":{"n":count,"p50":us,"p99":us,"max":us},...}
+ */
+void DiagnosticsNode::publishProfile() {
+#if LOOP_PROFILER
+  beginJson();
+  for (uint8_t i = 0; i < loopProfiler.getSlotCount(); i++) {
+    if (!appendJson("%s\"%s/%s\":{\"n\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}", (i > 0) ? "," : "",
+                    loopProfiler.getName(i), loopProfiler.getKind(i), (unsigned long)loopProfiler.getCount(i),
+                    (unsigned long)loopProfiler.getPercentile(i, 50), (unsigned long)loopProfiler.getPercentile(i, 99),
+                    (unsigned long)loopProfiler.getMax(i))) {
+      break;
+    }
+  }
+  endJson();
+
+  setProperty(cProfile).send(_buffer);
+  loopProfiler.reset();
+#endif
+}
+
+/**
+ * Share of time awake and the resulting current draw since the last publish.
+ */
+void DiagnosticsNode::publishPower() {
+  setProperty(cPowerMode).send(powerManager.getModeName());
+  setProperty(cDutyCycle).send(String(powerManager.getDutyCycle(), 1));
+  setProperty(cCurrentDraw).send(String(powerManager.getEstimatedCurrent(), 1));
+  powerManager.resetStatistics();
+}
+
+/**
+ * Latest heap sample; largest block is the smallest one seen since the last publish.
+ */
+void DiagnosticsNode::publishHeap() {
+  heapMonitor.sample();
+
+  setProperty(cFreeHeap).send(String(heapMonitor.getFreeHeap()));
+  setProperty(cMaxBlock).send(String(heapMonitor.getMinMaxBlock()));
+  setProperty(cFragmentation).send(String(heapMonitor.getFragmentation()));
+  setProperty(cMinFreeHeap).send(String(heapMonitor.getMinFreeHeap()));
+  setProperty(cStackFree).send(String(heapMonitor.getStackFree()));
+
+  heapMonitor.resetWindow();
+  setProperty(cHeapTrend).send(String(heapMonitor.getTrend()));
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::beginJson() {
+  _buffer[0] = '{';
+  _length    = 1;
+}
+
+/**
+ * Append formatted text, keeping room for endJson(). Returns false if it does not fit.
+ */
+bool DiagnosticsNode::appendJson(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  const int written = vsnprintf(_buffer + _length, BUFFER_SIZE - _length, format, args);
+  va_end(args);
+
+  if (written < 0 || (size_t)written >= BUFFER_SIZE - _length - 1) {
+    _buffer[_length] = '\0';
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ diagnostics truncated") << endl;
+    return false;
+  }
+  _length += written;
+  return true;
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::endJson() {
+  _buffer[_length++] = '}';
+  _buffer[_length]   = '\0';
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::printCaption() {
+  Homie.getLogger() << FPSTR(cCaption) << endl;
+}
@@ -0,0 +1,87 @@
+/**
+ * Homie Node for runtime diagnostics of the controller.
+ *
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include "DeadlineScheduler.hpp"
+#include "PowerManager.hpp"
+#include "LoopProfiler.hpp"
+#include "HeapMonitor.hpp"
+#include "OperationModeNode.hpp"
+#include "BootProfile.hpp"
+#include "NodeStrings.hpp"
+
+class DiagnosticsNode : public HomieNode {
+
+public:
+  DiagnosticsNode(const char* id, const char* name, const int publishInterval = PUBLISH_INTERVAL);
+
+  void          setPublishInterval(unsigned long interval);
+  void          setOperationModeNode(OperationModeNode* node) { _operationModeNode = node; }
+  void          triggerPublish() { scheduler.trigger(_publishTask); }
+  unsigned long getPublishInterval() const { return _publishInterval; }
+
+protected:
+  void setup() override;
+
+private:
+  static const int MIN_INTERVAL     = 60;  // in seconds
+  static const int PUBLISH_INTERVAL = 300;
+  static const int BUFFER_SIZE      = 768;
+
+  static const char cCaption[];
+
+  static const char cScheduler[];
+  static const char cSchedulerName[];
+
+  static const char cProfile[];
+  static const char cProfileName[];
+
+  static const char cBoot[];
+  static const char cBootName[];
+  static const char cFirstDecision[];
+  static const char cFirstDecisionName[];
+
+  static const char cFreeHeap[];
+  static const char cFreeHeapName[];
+  static const char cMaxBlock[];
+  static const char cMaxBlockName[];
+  static const char cFragmentation[];
+  static const char cFragmentationName[];
+  static const char cMinFreeHeap[];
+  static const char cMinFreeHeapName[];
+  static const char cHeapTrend[];
+  static const char cHeapTrendName[];
+  static const char cStackFree[];
+  static const char cStackFreeName[];
+
+  static const char cPowerMode[];
+  static const char cPowerModeName[];
+  static const char cDutyCycle[];
+  static const char cDutyCycleName[];
+  static const char cCurrentDraw[];
+  static const char cCurrentDrawName[];
+
+  unsigned long _publishInterval;
+  int8_t        _publishTask;
+  OperationModeNode* _operationModeNode;
+  bool               _bootPublished;
+
+  char   _buffer[BUFFER_SIZE];  // JSON of the property being published
+  size_t _length;
+
+  void        publish();
+  static void publishTask(void* node) { static_cast<DiagnosticsNode*>(node)->publish(); }
+  void        publishBoot();
+  void        publishScheduler();
+  void        publishProfile();
+  void        publishPower();
+  void        publishHeap();
+  void        beginJson();
+  bool        appendJson(const char* format, ...);
+  void        endJson();
+  void        printCaption();
+};
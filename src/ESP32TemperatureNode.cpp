@@ -5,6 +5,8 @@
 
 #include "ESP32TemperatureNode.hpp"
 
+const char ESP32TemperatureNode::cCaption[] PROGMEM = "• ESP32 Internal Temperature sensor:";
+
 /**
  * @param id
  */
@@ -12,37 +14,48 @@ ESP32TemperatureNode::ESP32TemperatureNode(const char* id, const char* name, con
     : HomieNode(id, name, "temperature") {
 
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = millis();
+  _measurementTask     = DeadlineScheduler::INVALID_TASK;
 }
 
 /**
  *
  */
-void ESP32TemperatureNode::printCaption() {
-  Homie.getLogger() << cCaption << endl;
+void ESP32TemperatureNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.setInterval(_measurementTask, _measurementInterval * 1000UL);
 }
 
 /**
  *
  */
-void ESP32TemperatureNode::loop() {
+void ESP32TemperatureNode::setup() {
+  _measurementTask = scheduler.addPeriodic(getId(), measureTask, this, _measurementInterval * 1000UL);
+}
 
-#ifdef ESP32
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-    _lastMeasurement = millis();
+/**
+ *
+ */
+void ESP32TemperatureNode::printCaption() {
+  Homie.getLogger() << FPSTR(cCaption) << endl;
+}
 
-    Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;
+/**
+ *
+ */
+void ESP32TemperatureNode::measure() {
 
-    //internal temp of ESP
-    const uint8_t temp_farenheit = temprature_sens_read();
-    const double  temp           = (temp_farenheit - 32) / 1.8;
+#ifdef ESP32
+  Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;
 
-    Homie.getLogger() << cIndent << F("Temperature = ") << temp << cTemperatureUnit << endl;
-    if(Homie.isConnected()) {
-      setProperty(cTemperature).send(String(temp, 2));
-      setProperty(cHomieNodeState).send(cHomieNodeState_OK);
-    }
+  //internal temp of ESP
+  const uint8_t temp_farenheit = temprature_sens_read();
+  char          temp[8];
+  formatCentiDegrees(centiFromFahrenheit(temp_farenheit), temp);
 
+  Homie.getLogger() << FPSTR(cIndent) << F("Temperature = ") << temp << cTemperatureUnit << endl;
+  if(Homie.isConnected()) {
+    setProperty(cTemperature).send(temp);
+    setProperty(cHomieNodeState).send(cHomieNodeState_OK);
   }
 #endif
 }
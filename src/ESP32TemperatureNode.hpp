@@ -6,6 +6,9 @@
 #pragma once
 
 #include <Homie.hpp>
+#include "DeadlineScheduler.hpp"
+#include "NodeStrings.hpp"
+#include "Temperature.hpp"
 
 #ifdef ESP32
 extern "C" {
@@ -20,36 +23,27 @@ public:
   ESP32TemperatureNode(const char* id, const char* name, const int measurementInterval = MEASUREMENT_INTERVAL);
 
   float         getTemperature() const { return temperature; }
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
 
 protected:
-  void loop() override;
+  void setup() override;
   void onReadyToOperate() override;
 
 private:
   // suggested rate is 1/60Hz (1m)
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
-  const char*      cCaption             = "• ESP32 Internal Temperature sensor:";
-  const char*      cIndent              = "  ◦ ";
-
-  const char* cTemperature     = "temperature";
-  const char* cTemperatureName = "Temperature";
-  const char* cTemperatureUnit = "°C";
-
-  const char* cHomieNodeState      = "state";
-  const char* cHomieNodeStateName  = "State";
-
-  const char* cHomieNodeState_OK    = "OK";
-  const char* cHomieNodeState_Error = "Error";
+  static const char cCaption[];
 
   bool          _sensorFound = false;
   unsigned int  _pin;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
+  int8_t        _measurementTask;
 
   float temperature = NAN;
 
-  void printCaption();
+  void        measure();
+  static void measureTask(void* node) { static_cast<ESP32TemperatureNode*>(node)->measure(); }
+  void        printCaption();
 };
@@ -0,0 +1,267 @@
+#include "FiltrationPlanner.hpp"
+
+/**
+ *
+ */
+FiltrationPlanner::FiltrationPlanner() {
+  memset(_cost, 0, sizeof(_cost));
+  memset(_layers, 0, sizeof(_layers));
+  memset(_runFromIdle, 0, sizeof(_runFromIdle));
+  memset(_runFromRun, 0, sizeof(_runFromRun));
+  _minRun     = 1;
+  _tableValid = false;
+  _planned    = 0;
+  _day        = 0;
+}
+
+/**
+ * Cost of a slot, e.g. derived from the electricity price. 0 is cheapest.
+ */
+void FiltrationPlanner::setSlotCost(const uint8_t slot, const uint8_t cost) {
+  if (slot < SLOTS && _cost[slot] != cost) {
+    _cost[slot] = cost;
+    _tableValid = false;
+  }
+}
+
+/**
+ * Prices of a day, today or the day ahead; count values spread evenly over the day (24 hourly, 48 half-hourly).
+ * The costs of the slots follow the prices of the current day, scaled from its cheapest (0) to its dearest slot (255).
+ * Returns false for a past day, a day after tomorrow or a count which does not divide the slots.
+ */
+bool FiltrationPlanner::setPrices(const uint16_t day, const int16_t* prices, const uint8_t count) {
+  if (day == 0 || (_day != 0 && (day < _day || day > _day + 1)) || count == 0 || count > SLOTS || SLOTS % count != 0) {
+    return false;
+  }
+
+  // same day, else a free layer, else the older one; with two days at most that is never the current one
+  PriceLayer* layer = &_layers[0];
+  for (uint8_t i = 0; i < 2; i++) {
+    if (_layers[i].day == day) {
+      layer = &_layers[i];
+      break;
+    }
+    if (_layers[i].day < layer->day) {
+      layer = &_layers[i];
+    }
+  }
+
+  layer->day = day;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    layer->prices[slot] = prices[slot * count / SLOTS];
+  }
+
+  if (day == _day) {
+    applyPrices();
+  }
+  return true;
+}
+
+/**
+ *
+ */
+bool FiltrationPlanner::hasPrices(const uint16_t day) const {
+  return day != 0 && (_layers[0].day == day || _layers[1].day == day);
+}
+
+/**
+ * Minimum number of consecutive slots the pump runs, 1 to MAX_MIN_RUN.
+ */
+void FiltrationPlanner::setMinRun(const uint8_t slots) {
+  const uint8_t minRun = (slots < 1) ? 1 : (slots > MAX_MIN_RUN) ? MAX_MIN_RUN : slots;
+  if (minRun != _minRun) {
+    _minRun     = minRun;
+    _tableValid = false;
+  }
+}
+
+/**
+ * Adjust the plan to the remaining runtime of the day.
+ *
+ * @param day             index of the local day, a new day starts with an empty plan
+ * @param secondOfDay     local time
+ * @param requiredSeconds runtime required for the whole day
+ * @param doneSeconds     runtime reached so far today
+ */
+void FiltrationPlanner::update(const uint16_t day, const uint32_t secondOfDay, const uint32_t requiredSeconds,
+                               const uint32_t doneSeconds) {
+  if (day != _day) {
+    _day     = day;
+    _planned = 0;
+    applyPrices();
+  }
+  if (!_tableValid) {
+    computeTable();
+  }
+
+  const uint8_t  current     = (secondOfDay / SLOT_SECONDS) % SLOTS;
+  const uint32_t currentLeft = SLOT_SECONDS - (secondOfDay % SLOT_SECONDS);
+  const uint64_t pastMask    = (1ULL << current) - 1;
+  const uint32_t need        = (requiredSeconds > doneSeconds) ? requiredSeconds - doneSeconds : 0;
+
+  if (need == 0) {
+    _planned &= pastMask;
+    return;
+  }
+
+  // the block running into the current slot, by the plan
+  uint8_t run = 0;
+  while (run < _minRun && run < current && isPlanned(current - 1 - run)) {
+    run++;
+  }
+
+  // fewest slots which deliver the runtime, the current one only counts with the time left
+  const uint8_t free  = SLOTS - current;
+  const uint8_t slots = (need + SLOT_SECONDS - 1) / SLOT_SECONDS;
+  uint64_t      plan  = 0;
+  for (uint8_t count = (slots < free) ? slots : free; count <= free; count++) {
+    if (!isFeasible(free, run, count)) {
+      continue;
+    }
+    plan                    = walk(current, run, count);
+    const uint32_t unused   = ((plan >> current) & 1) ? SLOT_SECONDS - currentLeft : 0;
+    const uint32_t capacity = SLOT_SECONDS * __builtin_popcountll(plan) - unused;
+    if (capacity >= need) {
+      break;
+    }
+  }
+
+  _planned = (_planned & pastMask) | plan;
+}
+
+/**
+ *
+ */
+uint8_t FiltrationPlanner::getPlannedCount() const {
+  return __builtin_popcountll(_planned);
+}
+
+/**
+ * Sun weight (0..100, peak at solar noon) against cost: 0 for the sunniest free slot, up to 355.
+ */
+uint16_t FiltrationPlanner::penalty(const uint8_t slot) const {
+  const int16_t center   = slot * (SLOT_SECONDS / 60) + SLOT_SECONDS / 120;
+  const int16_t distance = abs(center - (int16_t)SOLAR_NOON);
+  const int16_t sun      = (distance < SUN_HOURS * 60) ? 100 - (100 * distance) / (SUN_HOURS * 60) : 0;
+
+  return 100 - sun + _cost[slot];
+}
+
+/**
+ * Costs from the prices of the current day; without prices all slots cost the same.
+ */
+void FiltrationPlanner::applyPrices() {
+  const PriceLayer* layer = nullptr;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (_layers[i].day != 0 && _layers[i].day < _day) {
+      // yesterday, free for the day ahead
+      _layers[i].day = 0;
+    } else if (_layers[i].day == _day && _day != 0) {
+      layer = &_layers[i];
+    }
+  }
+
+  if (layer == nullptr) {
+    for (uint8_t slot = 0; slot < SLOTS; slot++) {
+      setSlotCost(slot, 0);
+    }
+    return;
+  }
+
+  int16_t lowest  = layer->prices[0];
+  int16_t highest = layer->prices[0];
+  for (uint8_t slot = 1; slot < SLOTS; slot++) {
+    lowest  = (layer->prices[slot] < lowest) ? layer->prices[slot] : lowest;
+    highest = (layer->prices[slot] > highest) ? layer->prices[slot] : highest;
+  }
+  const int32_t range = (int32_t)highest - lowest;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    setSlotCost(slot, (range > 0) ? ((int32_t)layer->prices[slot] - lowest) * 255 / range : 0);
+  }
+}
+
+/**
+ * Cheapest plans of all sizes, backwards from the end of the day.
+ *
+ * cost[j][r] is the least penalty of placing j slots from the slot on, where r is the length of the block running
+ * into it (0: pump off, capped at the minimum run). A block shorter than the minimum run has to continue, a block
+ * may only end at midnight once it is long enough. Only two rows are kept; the decisions for r = 0 and for a
+ * complete block go into _runFromIdle/_runFromRun, in between there is no choice.
+ */
+void FiltrationPlanner::computeTable() {
+  // about 1 KB of stack, only while computing
+  uint16_t next[SLOTS + 1][MAX_MIN_RUN + 1];
+  uint16_t cost[SLOTS + 1][MAX_MIN_RUN + 1];
+
+  for (uint8_t j = 0; j <= SLOTS; j++) {
+    for (uint8_t r = 0; r <= _minRun; r++) {
+      next[j][r] = (j == 0 && (r == 0 || r == _minRun)) ? 0 : INFEASIBLE;
+    }
+  }
+
+  for (uint8_t slot = SLOTS; slot-- > 0;) {
+    const uint16_t p = penalty(slot);
+    _runFromIdle[slot] = 0;
+    _runFromRun[slot]  = 0;
+
+    for (uint8_t j = 0; j <= SLOTS; j++) {
+      for (uint8_t r = 0; r <= _minRun; r++) {
+        const uint8_t  longer = (r < _minRun) ? r + 1 : _minRun;
+        const uint16_t run    = (j > 0 && next[j - 1][longer] != INFEASIBLE) ? next[j - 1][longer] + p : INFEASIBLE;
+        const uint16_t idle   = (r == 0 || r == _minRun) ? next[j][0] : INFEASIBLE;
+
+        // ties run earlier
+        if (run != INFEASIBLE && run <= idle) {
+          cost[j][r] = run;
+          _runFromIdle[slot] |= (r == 0) ? (1ULL << j) : 0;
+          _runFromRun[slot] |= (r == _minRun) ? (1ULL << j) : 0;
+        } else {
+          cost[j][r] = idle;
+        }
+      }
+    }
+    memcpy(next, cost, sizeof(next));
+  }
+
+  _tableValid = true;
+}
+
+/**
+ * Whether count slots can be placed in the free slots left, with a block of length run running into the first.
+ */
+bool FiltrationPlanner::isFeasible(const uint8_t free, const uint8_t run, const uint8_t count) const {
+  if (count > free) {
+    return false;
+  } else if (run == 0) {
+    return count == 0 || count >= _minRun;
+  } else if (run < _minRun) {
+    // the block has to be completed first
+    return count >= _minRun - run;
+  }
+  return true;
+}
+
+/**
+ * Slots of the cheapest plan of count slots from slot from on, following the decisions of computeTable().
+ */
+uint64_t FiltrationPlanner::walk(const uint8_t from, uint8_t run, uint8_t count) const {
+  uint64_t plan = 0;
+
+  for (uint8_t slot = from; slot < SLOTS && count > 0; slot++) {
+    bool on;
+    if (run > 0 && run < _minRun) {
+      on = true;
+    } else {
+      on = (((run == 0) ? _runFromIdle[slot] : _runFromRun[slot]) >> count) & 1;
+    }
+
+    if (on) {
+      plan |= 1ULL << slot;
+      count--;
+      run = (run < _minRun) ? run + 1 : _minRun;
+    } else {
+      run = 0;
+    }
+  }
+  return plan;
+}
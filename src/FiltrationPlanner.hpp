@@ -0,0 +1,74 @@
+/**
+ * Daily plan of the pool pump runtime.
+ *
+ * The day is split into SLOTS slots. Each slot has a penalty: sunny slots are
+ * cheap, expensive ones (by the electricity price of the day) dear. The pump
+ * runs in blocks of at least the minimum run of slots.
+ *
+ * A dynamic program over the slots of the day, computed backwards once per
+ * day or when the prices change, finds for every slot, every number of slots
+ * still to place and both pump states whether running in that slot is part of
+ * the cheapest plan from there on. update() only walks these decisions from
+ * the current slot, so a changed required runtime costs one pass over the
+ * remaining slots instead of planning the whole day again.
+ *
+ * Prices are kept for two days (today and the day ahead); the costs switch to
+ * the prices of the next day at midnight.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class FiltrationPlanner {
+
+public:
+  static const uint8_t  SLOTS        = 48;
+  static const uint16_t SLOT_SECONDS = 24 * 3600UL / SLOTS;
+  static const uint8_t  MAX_MIN_RUN  = 4;  // in slots
+
+  FiltrationPlanner();
+
+  void    setSlotCost(const uint8_t slot, const uint8_t cost);
+  uint8_t getSlotCost(const uint8_t slot) const { return _cost[slot]; }
+  bool    setPrices(const uint16_t day, const int16_t* prices, const uint8_t count);
+  bool    hasPrices(const uint16_t day) const;
+  void    setMinRun(const uint8_t slots);
+  uint8_t getMinRun() const { return _minRun; }
+
+  void     update(const uint16_t day, const uint32_t secondOfDay, const uint32_t requiredSeconds, const uint32_t doneSeconds);
+  bool     isPlanned(const uint8_t slot) const { return (_planned >> slot) & 1; }
+  uint64_t getPlan() const { return _planned; }
+  uint8_t  getPlannedCount() const;
+
+private:
+  static const uint16_t SOLAR_NOON = 13 * 60 + 30;  // local time in minutes (CEST)
+  static const uint16_t SUN_HOURS  = 6;             // sun weight drops to 0 this many hours before/after noon
+  static const uint16_t INFEASIBLE = 0xFFFF;
+
+  /**
+   * Prices of one day, in 1/100 of the unit published (e.g. ct/kWh).
+   */
+  struct PriceLayer {
+    uint16_t day;  // 0 if unused
+    int16_t  prices[SLOTS];
+  };
+
+  uint8_t    _cost[SLOTS];
+  PriceLayer _layers[2];
+  uint8_t    _minRun;  // in slots
+
+  // decisions of the plan, bit j: run in the slot with j slots still to place
+  uint64_t _runFromIdle[SLOTS];  // pump was off in the slot before
+  uint64_t _runFromRun[SLOTS];   // pump ran for at least the minimum run
+  bool     _tableValid;
+
+  uint64_t _planned;
+  uint16_t _day;
+
+  uint16_t penalty(const uint8_t slot) const;
+  void     applyPrices();
+  void     computeTable();
+  bool     isFeasible(const uint8_t free, const uint8_t run, const uint8_t count) const;
+  uint64_t walk(const uint8_t from, uint8_t run, uint8_t count) const;
+};
@@ -0,0 +1,305 @@
+/**
+ * Wear-levelled record journal for persistent controller state.
+ */
+#include "FlashJournal.hpp"
+#include <Homie.hpp>
+
+#ifdef ESP8266
+#include <spi_flash.h>
+
+extern "C" uint32_t _EEPROM_start;  // start of the EEPROM sector, provided by the linker script
+extern "C" uint32_t _FS_end;        // end of the file system
+#endif
+
+FlashJournal flashJournal;
+
+/**
+ *
+ */
+FlashJournal::FlashJournal() {
+  _initialized = false;
+  _writeCount  = 0;
+  _eraseCount  = 0;
+}
+
+/**
+ * Open the journal. Safe to call more than once; read() and write() call it on demand.
+ */
+void FlashJournal::begin() {
+  if (_initialized) {
+    return;
+  }
+  _initialized = true;
+
+#ifdef ESP32
+  preferences.begin("journal", false);
+#elif defined(ESP8266)
+  scan();
+#endif
+}
+
+/**
+ * Read the latest record of the given type.
+ * Returns false if there is none or its size does not match.
+ */
+bool FlashJournal::read(const uint8_t type, void* payload, const uint8_t length) {
+  begin();
+
+  if (type == 0 || type > MAX_RECORD_TYPES || length > MAX_PAYLOAD) {
+    return false;
+  }
+
+#ifdef ESP32
+  char key[4];
+  snprintf(key, sizeof(key), "r%u", type);
+  if (preferences.getBytesLength(key) != length) {
+    return false;
+  }
+  return preferences.getBytes(key, payload, length) == length;
+
+#elif defined(ESP8266)
+  const uint16_t offset = _latestOffset[type - 1];
+  if (offset == 0xFFFF) {
+    return false;
+  }
+
+  uint32_t buffer[(sizeof(RecordHeader) + MAX_PAYLOAD + 3) / 4];
+  if (!ESP.flashRead(sectorAddress() + offset, buffer, alignedSize(length))) {
+    return false;
+  }
+
+  RecordHeader header;
+  memcpy(&header, buffer, sizeof(header));
+  if (header.length != length) {
+    return false;
+  }
+
+  memcpy(payload, reinterpret_cast<uint8_t*>(buffer) + sizeof(RecordHeader), length);
+  return true;
+#endif
+}
+
+/**
+ * Persist a new version of the record of the given type.
+ * Callers are expected to write only when the payload actually changed.
+ */
+bool FlashJournal::write(const uint8_t type, const void* payload, const uint8_t length) {
+  begin();
+
+  if (type == 0 || type > MAX_RECORD_TYPES || length > MAX_PAYLOAD) {
+    return false;
+  }
+
+#ifdef ESP32
+  char key[4];
+  snprintf(key, sizeof(key), "r%u", type);
+  const bool retval = preferences.putBytes(key, payload, length) == length;
+
+#elif defined(ESP8266)
+  bool retval = append(type, payload, length);
+  if (!retval && compact()) {
+    retval = append(type, payload, length);
+  }
+#endif
+
+  if (retval) {
+    _writeCount++;
+  } else {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ FlashJournal: writing record ") << type << F(" failed") << endl;
+  }
+  return retval;
+}
+
+/**
+ * CRC-16/CCITT-FALSE.
+ */
+uint16_t FlashJournal::crc16(uint16_t crc, const uint8_t* data, size_t length) {
+  while (length--) {
+    crc ^= static_cast<uint16_t>(*data++) << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+ *
+ */
+uint16_t FlashJournal::recordCrc(const uint8_t type, const void* payload, const uint8_t length) {
+  const uint8_t head[2] = {type, length};
+  return crc16(crc16(0xFFFF, head, sizeof(head)), static_cast<const uint8_t*>(payload), length);
+}
+
+#ifdef ESP8266
+
+/**
+ * Sector 0 is the EEPROM sector, sector 1 the one below it.
+ */
+uint32_t FlashJournal::sectorAddress(const uint8_t sector) const {
+  return ((uintptr_t)&_EEPROM_start - 0x40200000) - sector * SPI_FLASH_SEC_SIZE;
+}
+
+/**
+ *
+ */
+bool FlashJournal::readSectorHeader(const uint8_t sector, SectorHeader& header) const {
+  uint32_t buffer[sizeof(SectorHeader) / 4];
+  if (!ESP.flashRead(sectorAddress(sector), buffer, sizeof(buffer))) {
+    return false;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  return header.magic == SECTOR_MAGIC && header.inverted == (uint16_t)~header.generation;
+}
+
+/**
+ * Walk the log once at boot: pick the newer of both sectors, remember the latest
+ * valid record of each type and the first erased offset. Costs a single pass over one sector.
+ */
+void FlashJournal::scan() {
+  // the file system ends on a block boundary, on most layouts one sector below the EEPROM sector
+  _sectorCount = ((uintptr_t)&_FS_end <= (uintptr_t)&_EEPROM_start - SPI_FLASH_SEC_SIZE) ? 2 : 1;
+  if (_sectorCount < 2) {
+    Homie.getLogger() << FPSTR(cIndent) << F("⚠ FlashJournal: no spare sector, compaction is not power-safe") << endl;
+  }
+
+  bool found    = false;
+  _activeSector = 0;
+  _generation   = 0;
+  for (uint8_t sector = 0; sector < _sectorCount; sector++) {
+    SectorHeader header;
+    if (readSectorHeader(sector, header) && (!found || (int16_t)(header.generation - _generation) > 0)) {
+      found         = true;
+      _activeSector = sector;
+      _generation   = header.generation;
+    }
+  }
+
+  for (uint8_t i = 0; i < MAX_RECORD_TYPES; i++) {
+    _latestOffset[i] = 0xFFFF;
+  }
+  _writeOffset = sizeof(SectorHeader);
+  _tailErased  = found;  // without a header the first write compacts, which writes one
+  if (!found) {
+    return;
+  }
+
+  uint32_t buffer[(sizeof(RecordHeader) + MAX_PAYLOAD + 3) / 4];
+
+  while (_writeOffset + sizeof(RecordHeader) <= SPI_FLASH_SEC_SIZE) {
+    if (!ESP.flashRead(sectorAddress() + _writeOffset, buffer, sizeof(RecordHeader))) {
+      _tailErased = false;
+      return;
+    }
+    if (buffer[0] == 0xFFFFFFFF) {
+      break;  // end of log
+    }
+
+    RecordHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    const uint16_t size = alignedSize(header.length);
+
+    if (header.type == 0 || header.type > MAX_RECORD_TYPES || header.length > MAX_PAYLOAD ||
+        _writeOffset + size > SPI_FLASH_SEC_SIZE) {
+      // garbage header, the rest of the sector cannot be trusted
+      _tailErased = false;
+      return;
+    }
+
+    if (ESP.flashRead(sectorAddress() + _writeOffset, buffer, size) &&
+        recordCrc(header.type, reinterpret_cast<uint8_t*>(buffer) + sizeof(RecordHeader), header.length) == header.crc) {
+      _latestOffset[header.type - 1] = _writeOffset;
+    }
+    _writeOffset += size;
+  }
+
+  // a write torn by a power cut may have programmed payload words behind the last header
+  for (uint16_t offset = _writeOffset; offset < SPI_FLASH_SEC_SIZE && _tailErased; offset += sizeof(buffer)) {
+    const uint16_t chunk = (SPI_FLASH_SEC_SIZE - offset < (int)sizeof(buffer)) ? SPI_FLASH_SEC_SIZE - offset : sizeof(buffer);
+    ESP.flashRead(sectorAddress() + offset, buffer, chunk);
+    for (uint16_t i = 0; i < chunk / 4; i++) {
+      if (buffer[i] != 0xFFFFFFFF) {
+        _tailErased = false;
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Program a record into the erased tail of the sector.
+ * Returns false if there is no room left.
+ */
+bool FlashJournal::append(const uint8_t type, const void* payload, const uint8_t length) {
+  const uint16_t size = alignedSize(length);
+  if (!_tailErased || _writeOffset + size > SPI_FLASH_SEC_SIZE) {
+    return false;
+  }
+
+  uint32_t buffer[(sizeof(RecordHeader) + MAX_PAYLOAD + 3) / 4];
+  memset(buffer, 0xFF, size);
+
+  RecordHeader header = {type, length, recordCrc(type, payload, length)};
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(reinterpret_cast<uint8_t*>(buffer) + sizeof(RecordHeader), payload, length);
+
+  if (!ESP.flashWrite(sectorAddress() + _writeOffset, buffer, size)) {
+    _tailErased = false;
+    return false;
+  }
+
+  _latestOffset[type - 1] = _writeOffset;
+  _writeOffset += size;
+  return true;
+}
+
+/**
+ * Copy the latest record of each type into the other sector and switch to it.
+ * The sector header is written last: until then the previous sector stays the newer one after a reboot.
+ */
+bool FlashJournal::compact() {
+  uint32_t keep[MAX_RECORD_TYPES][(sizeof(RecordHeader) + MAX_PAYLOAD + 3) / 4];
+  bool     valid[MAX_RECORD_TYPES];
+
+  for (uint8_t i = 0; i < MAX_RECORD_TYPES; i++) {
+    valid[i] = (_latestOffset[i] != 0xFFFF) && ESP.flashRead(sectorAddress() + _latestOffset[i], keep[i], sizeof(RecordHeader));
+    if (valid[i]) {
+      RecordHeader header;
+      memcpy(&header, keep[i], sizeof(header));
+      valid[i] = ESP.flashRead(sectorAddress() + _latestOffset[i], keep[i], alignedSize(header.length));
+    }
+  }
+
+  const uint8_t target = (_activeSector + 1) % _sectorCount;
+  if (!ESP.flashEraseSector(sectorAddress(target) / SPI_FLASH_SEC_SIZE)) {
+    return false;
+  }
+  _eraseCount++;
+  _activeSector = target;
+  _writeOffset  = sizeof(SectorHeader);
+  _tailErased   = true;
+
+  for (uint8_t i = 0; i < MAX_RECORD_TYPES; i++) {
+    _latestOffset[i] = 0xFFFF;
+    if (valid[i]) {
+      RecordHeader header;
+      memcpy(&header, keep[i], sizeof(header));
+      append(header.type, reinterpret_cast<uint8_t*>(keep[i]) + sizeof(RecordHeader), header.length);
+    }
+  }
+
+  const uint16_t generation = _generation + 1;
+  SectorHeader   header     = {SECTOR_MAGIC, generation, (uint16_t)~generation};
+  uint32_t       buffer[sizeof(SectorHeader) / 4];
+  memcpy(buffer, &header, sizeof(header));
+  if (!ESP.flashWrite(sectorAddress(), buffer, sizeof(buffer))) {
+    scan();  // back to the previous sector
+    return false;
+  }
+  _generation = generation;
+
+  Homie.getLogger() << FPSTR(cIndent) << F("FlashJournal: compacted into sector ") << _activeSector << endl;
+  return true;
+}
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Wear-levelled record journal for persistent controller state.
+ *
+ * Small typed records (relay states, counters, ...) are appended to a log
+ * instead of being rewritten in place. The latest valid record of each type
+ * wins on read.
+ *
+ * ESP8266: the log lives in the flash sector reserved for the EEPROM emulation
+ * and the unused sector below it. Records are programmed into erased space of
+ * the active sector; once it is full, the latest record of each type is copied
+ * into the other sector, which becomes active when its header is written last.
+ * A power cut during compaction leaves the previous sector in use.
+ *
+ * ESP32: NVS already is a wear-levelled log, so each record type is a blob
+ * in its own Preferences key.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#ifdef ESP32
+#include <Preferences.h>
+#elif defined(ESP8266)
+
+#endif
+#include "NodeStrings.hpp"
+
+enum JournalRecordType : uint8_t {
+  RECORD_RELAY_STATE = 1,
+  RECORD_RELAY_STATS = 2,
+  RECORD_SETTINGS    = 3,
+};
+
+class FlashJournal {
+
+public:
+  static const uint8_t MAX_RECORD_TYPES = 4;    // record types 1..MAX_RECORD_TYPES
+  static const uint8_t MAX_PAYLOAD      = 160;  // in bytes
+
+  FlashJournal();
+
+  void begin();
+  bool read(const uint8_t type, void* payload, const uint8_t length);
+  bool write(const uint8_t type, const void* payload, const uint8_t length);
+
+  uint32_t getWriteCount() const { return _writeCount; }
+  uint32_t getEraseCount() const { return _eraseCount; }
+
+private:
+  struct RecordHeader {
+    uint8_t  type;
+    uint8_t  length;  // payload length in bytes
+    uint16_t crc;     // CRC-16/CCITT of type, length and payload
+  };
+
+  struct SectorHeader {
+    uint32_t magic;       // first byte is never a record type
+    uint16_t generation;  // incremented by each compaction, the newer sector wins
+    uint16_t inverted;    // ~generation, detects a torn header write
+  };
+
+  static const uint32_t SECTOR_MAGIC = 0x4A524E4C;
+
+  bool     _initialized;
+  uint32_t _writeCount;
+  uint32_t _eraseCount;
+
+#ifdef ESP32
+  Preferences preferences;
+#elif defined(ESP8266)
+  uint8_t  _sectorCount;                     // 1 if there is no free sector below the EEPROM sector
+  uint8_t  _activeSector;                    // 0: EEPROM sector, 1: the sector below
+  uint16_t _generation;
+  uint16_t _writeOffset;                     // first erased byte in the active sector
+  bool     _tailErased;                      // false if a torn write left garbage behind the log
+  uint16_t _latestOffset[MAX_RECORD_TYPES];  // offset of the latest record per type, 0xFFFF if none
+
+  void     scan();
+  bool     readSectorHeader(const uint8_t sector, SectorHeader& header) const;
+  bool     compact();
+  bool     append(const uint8_t type, const void* payload, const uint8_t length);
+  uint32_t sectorAddress(const uint8_t sector) const;
+  uint32_t sectorAddress() const { return sectorAddress(_activeSector); }
+#endif
+
+  static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t length);
+  static uint16_t recordCrc(const uint8_t type, const void* payload, const uint8_t length);
+  static uint16_t alignedSize(const uint8_t length) { return (sizeof(RecordHeader) + length + 3) & ~3; }
+};
+
+extern FlashJournal flashJournal;
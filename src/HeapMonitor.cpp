@@ -0,0 +1,97 @@
+/**
+ * Heap and stack telemetry.
+ */
+#include "HeapMonitor.hpp"
+#include <Homie.hpp>
+#include "RelayStateStore.hpp"
+#include "SettingsStore.hpp"
+
+HeapMonitor heapMonitor;
+
+/**
+ *
+ */
+HeapMonitor::HeapMonitor() {
+  _restartLimit   = 0;
+  _lowSamples     = 0;
+  _freeHeap       = 0;
+  _maxBlock       = 0;
+  _fragmentation  = 0;
+  _minFreeHeap    = UINT32_MAX;
+  _stackFree      = 0;
+  _windowSum      = 0;
+  _windowSamples  = 0;
+  _windowMinBlock = UINT32_MAX;
+  _windowStart    = 0;
+  _lastAverage    = 0;
+  _trend          = 0;
+}
+
+/**
+ *
+ */
+void HeapMonitor::sample() {
+#ifdef ESP32
+  _freeHeap    = ESP.getFreeHeap();
+  _maxBlock    = ESP.getMaxAllocHeap();
+  _minFreeHeap = ESP.getMinFreeHeap();
+  // ESP-IDF reports the stack in bytes
+  _stackFree     = uxTaskGetStackHighWaterMark(NULL);
+  _fragmentation = (_freeHeap > 0) ? 100 - (uint8_t)((uint64_t)_maxBlock * 100 / _freeHeap) : 0;
+#elif defined(ESP8266)
+  ESP.getHeapStats(&_freeHeap, &_maxBlock, &_fragmentation);
+  if (_freeHeap < _minFreeHeap) {
+    _minFreeHeap = _freeHeap;
+  }
+  _stackFree = ESP.getFreeContStack();
+#endif
+
+  _windowSum += _freeHeap;
+  _windowSamples++;
+  if (_maxBlock < _windowMinBlock) {
+    _windowMinBlock = _maxBlock;
+  }
+
+  // no restart loop if the limit cannot be met at all
+  if (_restartLimit > 0 && _maxBlock < _restartLimit && millis() >= RESTART_MIN_UPTIME) {
+    Homie.getLogger() << F("✖ Largest free heap block ") << _maxBlock << F(" below ") << _restartLimit << endl;
+    if (++_lowSamples >= RESTART_SAMPLES) {
+      restart();
+    }
+  } else {
+    _lowSamples = 0;
+  }
+}
+
+/**
+ * Compute the trend and start a new window, call after publishing.
+ */
+void HeapMonitor::resetWindow() {
+  if (_windowSamples > 0) {
+    const uint32_t      average = _windowSum / _windowSamples;
+    const unsigned long length  = millis() - _windowStart;
+
+    if (_lastAverage > 0 && length > 0) {
+      // windows have the same length, so do the distances of their centers
+      _trend = (int32_t)(((int64_t)average - (int64_t)_lastAverage) * 3600000LL / (int64_t)length);
+    }
+    _lastAverage = average;
+  }
+
+  _windowStart    = millis();
+  _windowSum      = 0;
+  _windowSamples  = 0;
+  _windowMinBlock = UINT32_MAX;
+}
+
+/**
+ * Save the relay states and restart while there is still enough heap to do so cleanly.
+ */
+void HeapMonitor::restart() {
+  Homie.getLogger() << F("✖ Heap fragmented, restarting") << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("free: ") << _freeHeap << F(" largest block: ") << _maxBlock << endl;
+
+  relayStateStore.flush();
+  settingsStore.flush();
+  Homie.reboot();
+}
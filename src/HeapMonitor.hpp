@@ -0,0 +1,65 @@
+/**
+ * Heap and stack telemetry.
+ *
+ * Samples free heap, largest free block and fragmentation every
+ * SAMPLE_INTERVAL. The minimum ever free heap and the stack high-water mark
+ * come from the framework where available. The heap trend is the change of
+ * the average free heap between two windows, scaled to bytes per hour.
+ *
+ * Long running ESP8266 devices fragment their heap slowly until OTA or a TLS
+ * handshake cannot allocate a contiguous block anymore. With a restart limit
+ * set, a largest free block below the limit for RESTART_SAMPLES samples in a
+ * row saves the relay states and restarts the controller, at the earliest
+ * RESTART_MIN_UPTIME after boot.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "NodeStrings.hpp"
+
+class HeapMonitor {
+
+public:
+  static const unsigned long SAMPLE_INTERVAL = 10 * 1000UL;  // in ms
+
+  HeapMonitor();
+
+  void     setRestartLimit(const uint32_t bytes) { _restartLimit = bytes; }
+  uint32_t getRestartLimit() const { return _restartLimit; }
+
+  void sample();
+
+  uint32_t getFreeHeap() const { return _freeHeap; }
+  uint32_t getMaxBlock() const { return _maxBlock; }
+  uint8_t  getFragmentation() const { return _fragmentation; }  // in %
+  uint32_t getMinFreeHeap() const { return _minFreeHeap; }      // since boot
+  uint32_t getMinMaxBlock() const { return _windowMinBlock; }   // in the window
+  uint32_t getStackFree() const { return _stackFree; }          // high-water mark of the loop task
+  int32_t  getTrend() const { return _trend; }                  // in bytes/h
+  void     resetWindow();
+
+private:
+  static const uint8_t       RESTART_SAMPLES    = 3;
+  static const unsigned long RESTART_MIN_UPTIME = 15 * 60 * 1000UL;  // in ms
+
+  uint32_t _restartLimit;  // in bytes, 0 disables the restart
+  uint8_t  _lowSamples;
+
+  uint32_t _freeHeap;
+  uint32_t _maxBlock;
+  uint8_t  _fragmentation;
+  uint32_t _minFreeHeap;
+  uint32_t _stackFree;
+
+  uint32_t      _windowSum;  // sum of the free heap samples in the window
+  uint16_t      _windowSamples;
+  uint32_t      _windowMinBlock;
+  unsigned long _windowStart;  // millis()
+  uint32_t      _lastAverage;  // average free heap of the previous window, 0 if none
+  int32_t       _trend;
+
+  void restart();
+};
+
+extern HeapMonitor heapMonitor;
@@ -0,0 +1,53 @@
+/**
+ * Ring of recent samples.
+ */
+#include "History.hpp"
+#include "CriticalSection.hpp"
+
+History history;
+
+/**
+ *
+ */
+History::History() {
+  _next  = 0;
+  _count = 0;
+}
+
+/**
+ *
+ */
+void History::add(const int16_t pool, const int16_t solar, const uint8_t relays) {
+  HistorySample sample;
+  sample.time   = millis() / 1000;
+  sample.pool   = pool;
+  sample.solar  = solar;
+  sample.relays = relays;
+
+  CriticalSection lock;
+  _samples[_next] = sample;
+  _next           = (_next + 1) % SIZE;
+  if (_count < SIZE) {
+    _count++;
+  }
+}
+
+/**
+ *
+ */
+uint8_t History::getCount() const {
+  CriticalSection lock;
+  return _count;
+}
+
+/**
+ * Copy of sample i, false if there is none.
+ */
+bool History::get(const uint8_t i, HistorySample& sample) const {
+  CriticalSection lock;
+  if (i >= _count) {
+    return false;
+  }
+  sample = _samples[(_next + SIZE - _count + i) % SIZE];
+  return true;
+}
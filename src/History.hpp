@@ -0,0 +1,38 @@
+/**
+ * Recent history of temperatures and pump states for the local HTTP API.
+ *
+ * A ring of SIZE samples taken every INTERVAL by a scheduler task, 24 h with
+ * the defaults. The oldest sample is overwritten; nothing is persisted.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "Temperature.hpp"
+
+struct HistorySample {
+  uint32_t time;    // millis() / 1000
+  int16_t  pool;    // centi-degrees
+  int16_t  solar;   // centi-degrees
+  uint8_t  relays;  // bit per relay of the topology
+};
+
+class History {
+
+public:
+  static const uint8_t       SIZE     = 96;
+  static const unsigned long INTERVAL = 15 * 60 * 1000UL;  // in ms
+
+  History();
+
+  void    add(const int16_t pool, const int16_t solar, const uint8_t relays);
+  uint8_t getCount() const;
+  bool    get(const uint8_t i, HistorySample& sample) const;  // 0 is the oldest
+
+private:
+  HistorySample _samples[SIZE];
+  uint8_t       _next;
+  uint8_t       _count;
+};
+
+extern History history;
@@ -0,0 +1,954 @@
+/**
+ * Local HTTP JSON API.
+ */
+#include "HttpApi.hpp"
+#include "HeapMonitor.hpp"
+#include "History.hpp"
+#include "CriticalSection.hpp"
+#include "TimeClientHelper.hpp"
+#include <stdarg.h>
+
+HttpApi httpApi;
+
+// in RAM, the web server reads them byte by byte
+const char HttpApi::cContentType[]        = "application/json";
+const char HttpApi::cMetricsContentType[] = "text/plain; version=0.0.4";
+const char HttpApi::cNotFound[]           = "{\"error\":\"not found\"}";
+const char HttpApi::cBusy[]               = "{\"error\":\"busy\"}";
+const char HttpApi::cTooLarge[]           = "{\"error\":\"request too large\"}";
+const char HttpApi::cInvalidSettings[]    = "{\"error\":\"invalid settings\"}";
+const char HttpApi::cAccepted[]           = "{\"status\":\"accepted\"}";
+
+/**
+ * Temperature as JSON number, null if invalid.
+ */
+static const char* jsonTemperature(const int16_t value, char* buffer) {
+  if (value == TEMPERATURE_INVALID) {
+    return "null";
+  }
+  formatCentiDegrees(value, buffer);
+  return buffer;
+}
+
+/**
+ * Metric families of /metrics, in this order. Profiler and scheduler values cover the time since the last publish
+ * of node diagnostics, which resets them.
+ */
+enum Metric : uint8_t {
+  METRIC_UPTIME,
+  METRIC_FREE_HEAP,
+  METRIC_MAX_BLOCK,
+  METRIC_MIN_FREE_HEAP,
+  METRIC_FRAGMENTATION,
+  METRIC_RSSI,
+  METRIC_SYNC_AGE,
+  METRIC_TEMPERATURE,
+  METRIC_RELAY_ON,
+  METRIC_RELAY_PENDING,
+  METRIC_RELAY_CYCLES,
+  METRIC_RELAY_RUNTIME,
+  METRIC_MODE,
+  METRIC_SETTING,
+  METRIC_LATENESS,
+  METRIC_DURATION,
+  METRIC_REQUESTS,
+  METRIC_REJECTED,
+  METRIC_COUNT
+};
+
+struct MetricFamily {
+  const char* name;
+  const char* type;
+  const char* help;
+};
+
+static const MetricFamily METRICS[METRIC_COUNT] = {
+    {"pool_uptime_seconds", "counter", "Time since boot."},
+    {"pool_heap_free_bytes", "gauge", "Free heap."},
+    {"pool_heap_max_block_bytes", "gauge", "Largest free block of the heap."},
+    {"pool_heap_min_free_bytes", "gauge", "Lowest free heap since boot."},
+    {"pool_heap_fragmentation_percent", "gauge", "Fragmentation of the heap."},
+    {"pool_wifi_rssi_dbm", "gauge", "WiFi signal strength."},
+    {"pool_ntp_sync_age_seconds", "gauge", "Time since the last NTP sync, NaN before it."},
+    {"pool_temperature_celsius", "gauge", "Temperature by sensor node, NaN without reading."},
+    {"pool_relay_on", "gauge", "Relay switched on."},
+    {"pool_relay_pending", "gauge", "Switch of the relay queued."},
+    {"pool_relay_cycles_total", "counter", "Pump starts."},
+    {"pool_relay_runtime_seconds_total", "counter", "Pump runtime."},
+    {"pool_mode", "gauge", "Operation mode, 1 for the active one."},
+    {"pool_setting", "gauge", "Numeric settings of node operation-mode."},
+    {"pool_scheduler_lateness_milliseconds", "gauge", "Start delay of tasks."},
+    {"pool_task_duration_microseconds", "gauge", "Duration of tasks, rounded up."},
+    {"pool_http_requests_total", "counter", "Requests to the HTTP API."},
+    {"pool_http_rejected_total", "counter", "Requests to the HTTP API rejected as busy."},
+};
+
+/**
+ * Value of a metric sample, NaN if invalid.
+ */
+static const char* metricTemperature(const int16_t value, char* buffer) {
+  if (value == TEMPERATURE_INVALID) {
+    return "NaN";
+  }
+  formatCentiDegrees(value, buffer);
+  return buffer;
+}
+
+/**
+ * The property "mode" of node operation-mode, its format lists the modes.
+ */
+static const PropertySpec& modeProperty() {
+  const size_t properties = OperationModeNode::getPropertyCount();
+  for (uint8_t i = 0; i < properties; i++) {
+    if (strcmp(OperationModeNode::getProperty(i).id, "mode") == 0) {
+      return OperationModeNode::getProperty(i);
+    }
+  }
+  return OperationModeNode::getProperty(0);
+}
+
+/**
+ * Value number index of a comma separated list into buffer; false if there are fewer values.
+ */
+static bool listValue(const char* list, uint16_t index, char* buffer, const size_t size) {
+  for (; index > 0 && *list != '\0'; list++) {
+    if (*list == ',') {
+      index--;
+    }
+  }
+  if (index > 0 || *list == '\0') {
+    return false;
+  }
+  size_t length = 0;
+  while (list[length] != '\0' && list[length] != ',' && length + 1 < size) {
+    buffer[length] = list[length];
+    length++;
+  }
+  buffer[length] = '\0';
+  return true;
+}
+
+/**
+ *
+ */
+HttpApi::HttpApi() {
+  _server            = nullptr;
+  _socket            = nullptr;
+  _operationModeNode = nullptr;
+  _sensors           = nullptr;
+  _sensorCount       = 0;
+  _relays            = nullptr;
+  _relayCount        = 0;
+  _planner           = nullptr;
+  _updateTask        = DeadlineScheduler::INVALID_TASK;
+  _bodyRequest       = nullptr;
+  _bodyLength        = 0;
+  _bodyPending       = false;
+  _requests          = 0;
+  _rejected          = 0;
+  _frames            = 0;
+  memset(&_snapshot, 0, sizeof(_snapshot));
+  memset(_taskCounters, 0, sizeof(_taskCounters));
+#if LOOP_PROFILER
+  memset(_slotCounters, 0, sizeof(_slotCounters));
+#endif
+  memset(_streams, 0, sizeof(_streams));
+  memset(_clients, 0, sizeof(_clients));
+}
+
+/**
+ *
+ */
+void HttpApi::setSensors(DallasTemperatureNode* nodes, const uint8_t count) {
+  _sensors     = nodes;
+  _sensorCount = (count < MAX_SENSORS) ? count : MAX_SENSORS;
+}
+
+/**
+ *
+ */
+void HttpApi::setRelays(RelayModuleNode* nodes, const uint8_t count) {
+  _relays     = nodes;
+  _relayCount = (count < MAX_RELAYS) ? count : MAX_RELAYS;
+}
+
+/**
+ * Start the web server; port 0 leaves it off.
+ */
+void HttpApi::begin(const uint16_t port) {
+  if (port == 0 || _server != nullptr || _operationModeNode == nullptr) {
+    return;
+  }
+
+  _server = new AsyncWebServer(port);
+  _server->on("/api/state", HTTP_GET, [this](AsyncWebServerRequest* request) { handleStream(request, STREAM_STATE); });
+  _server->on("/api/history", HTTP_GET, [this](AsyncWebServerRequest* request) { handleStream(request, STREAM_HISTORY); });
+  _server->on("/metrics", HTTP_GET, [this](AsyncWebServerRequest* request) { handleStream(request, STREAM_METRICS); });
+  _server->on("/api/heap", HTTP_GET, [this](AsyncWebServerRequest* request) { handleHeap(request); });
+  _server->on(
+      "/api/settings", HTTP_POST, [this](AsyncWebServerRequest* request) { handleSettings(request); }, nullptr,
+      [this](AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index, size_t total) {
+        handleBody(request, data, length, index, total);
+      });
+  _socket = new AsyncWebSocket("/api/live");
+  _socket->onEvent([this](AsyncWebSocket*, AsyncWebSocketClient* client, AwsEventType type, void*, uint8_t*, size_t) {
+    handleSocketEvent(client, type);
+  });
+  _server->addHandler(_socket);
+  _server->onNotFound([](AsyncWebServerRequest* request) { request->send(404, cContentType, cNotFound); });
+
+  update();
+  _updateTask = scheduler.addPeriodic("http-api", updateTask, this, UPDATE_INTERVAL);
+  _server->begin();
+
+  Homie.getLogger() << F("HTTP API on port ") << port << endl;
+}
+
+/**
+ * Runs in loop(): refresh the snapshot, apply validated settings.
+ */
+void HttpApi::update() {
+  Snapshot snapshot;
+  memset(&snapshot, 0, sizeof(snapshot));
+
+  snapshot.uptime        = millis() / 1000;
+  snapshot.freeHeap      = heapMonitor.getFreeHeap();
+  snapshot.maxBlock      = heapMonitor.getMaxBlock();
+  snapshot.minFreeHeap   = heapMonitor.getMinFreeHeap();
+  snapshot.fragmentation = heapMonitor.getFragmentation();
+  snapshot.rssi          = (WiFi.status() == WL_CONNECTED) ? WiFi.RSSI() : 0;
+  snapshot.syncAge       = getSyncAge();
+  snapshot.settings      = _operationModeNode->getSettings();
+  for (uint8_t i = 0; i < _sensorCount; i++) {
+    snapshot.temperatures[i] = _sensors[i].getTemperature();
+  }
+  for (uint8_t i = 0; i < _relayCount; i++) {
+    snapshot.relays |= _relays[i].getSwitch() ? (1 << i) : 0;
+    snapshot.pending |= _relays[i].isPending() ? (1 << i) : 0;
+
+    const RelayStatistics& statistics = _relays[i].getStatistics();
+    snapshot.cycles[i]                = statistics.cycles;
+    snapshot.runtime[i]               = statistics.onTimeTotal;
+  }
+  snapshot.plan = (_planner != nullptr) ? _planner->getPlan() : 0;
+
+  // scheduler and profiler belong to loop(), /metrics renders from these copies
+  snapshot.taskCount = scheduler.getTaskCount();
+  for (uint8_t task = 0; task < snapshot.taskCount; task++) {
+    const SchedulerTaskStatistics& statistics = scheduler.getStatistics(task);
+    const Counters                 counters   = {scheduler.getTaskName(task),
+                                                 nullptr,
+                                                 {statistics.avgLateness, statistics.maxLateness, 0}};
+    CriticalSection lock;
+    _taskCounters[task] = counters;
+  }
+#if LOOP_PROFILER
+  snapshot.slotCount = loopProfiler.getSlotCount();
+  for (uint8_t slot = 0; slot < snapshot.slotCount; slot++) {
+    const uint32_t median   = loopProfiler.getPercentile(slot, 50);
+    const uint32_t p99      = loopProfiler.getPercentile(slot, 99);
+    const Counters counters = {loopProfiler.getName(slot), loopProfiler.getKind(slot), {median, p99, loopProfiler.getMax(slot)}};
+    CriticalSection lock;
+    _slotCounters[slot] = counters;
+  }
+#endif
+
+  bool     pending;
+  uint32_t changes;
+  {
+    CriticalSection lock;
+    changes   = changedFields(snapshot, _snapshot);
+    _snapshot = snapshot;
+    pending   = _bodyPending;
+  }
+
+  push(changes);
+
+  if (pending) {
+    // the web server leaves the body alone until it is released
+    _operationModeNode->updateConfig(_body);
+
+    CriticalSection lock;
+    _bodyPending = false;
+    _bodyRequest = nullptr;
+  }
+}
+
+/**
+ * GET of a chunked response, rendered from a stream buffer.
+ */
+void HttpApi::handleStream(AsyncWebServerRequest* request, const StreamKind kind) {
+  Stream* stream = acquireStream();
+  {
+    CriticalSection lock;
+    _requests++;
+    if (stream == nullptr) {
+      _rejected++;
+    } else {
+      stream->snapshot = _snapshot;
+    }
+  }
+  if (stream == nullptr) {
+    request->send(503, cContentType, cBusy);
+    return;
+  }
+
+  stream->kind     = kind;
+  stream->item     = 0;
+  stream->length   = 0;
+  stream->position = 0;
+  stream->done     = false;
+
+  // the buffer is free again once the connection is gone, completed or not
+  request->onDisconnect([stream]() { stream->used = false; });
+  const char* contentType = (kind == STREAM_METRICS) ? cMetricsContentType : cContentType;
+  request->send(request->beginChunkedResponse(contentType, [this, stream](uint8_t* buffer, size_t size, size_t) {
+    return fill(*stream, buffer, size);
+  }));
+}
+
+/**
+ * GET /api/heap: a single line without a stream buffer, so it is answered even while all of them are in use.
+ */
+void HttpApi::handleHeap(AsyncWebServerRequest* request) {
+  unsigned long uptime, freeHeap, maxBlock, minFreeHeap;
+  unsigned      fragmentation;
+  {
+    CriticalSection lock;
+    _requests++;
+    uptime        = _snapshot.uptime;
+    freeHeap      = _snapshot.freeHeap;
+    maxBlock      = _snapshot.maxBlock;
+    minFreeHeap   = _snapshot.minFreeHeap;
+    fragmentation = _snapshot.fragmentation;
+  }
+
+  char body[HEAP_SIZE];
+  snprintf(body, sizeof(body), "{\"uptime\":%lu,\"free-heap\":%lu,\"max-block\":%lu,\"min-free-heap\":%lu,\"fragmentation\":%u}",
+           uptime, freeHeap, maxBlock, minFreeHeap, fragmentation);
+  request->send(200, cContentType, body);
+}
+
+/**
+ * Body of POST /api/settings, possibly in several parts.
+ */
+void HttpApi::handleBody(AsyncWebServerRequest* request, const uint8_t* data, const size_t length, const size_t index,
+                         const size_t total) {
+  if (index == 0) {
+    CriticalSection lock;
+    if (_bodyPending || total >= BODY_SIZE) {
+      // handleSettings() rejects the request
+      return;
+    }
+    _bodyRequest = request;
+    _bodyLength  = 0;
+  }
+
+  if (request != _bodyRequest || _bodyLength + length >= BODY_SIZE) {
+    return;
+  }
+  memcpy(_body + _bodyLength, data, length);
+  _bodyLength += length;
+  _body[_bodyLength] = '\0';
+}
+
+/**
+ * POST /api/settings after the body: validate right away, apply in loop().
+ * The lock only guards the shared fields, responses are sent after it.
+ */
+void HttpApi::handleSettings(AsyncWebServerRequest* request) {
+  const size_t    contentLength = request->contentLength();
+  int             status        = 0;  // 0: the body belongs to this request
+  ControlSettings settings;
+  {
+    CriticalSection lock;
+    _requests++;
+    if (contentLength == 0) {
+      status = 400;
+    } else if (contentLength >= BODY_SIZE) {
+      status = 413;
+      _rejected++;
+    } else if (request != _bodyRequest || _bodyPending) {
+      status = 503;
+      _rejected++;
+    } else {
+      settings = _snapshot.settings;
+    }
+  }
+
+  if (status == 400) {
+    request->send(400, cContentType, cInvalidSettings);
+    return;
+  }
+  if (status == 413) {
+    request->send(413, cContentType, cTooLarge);
+    return;
+  }
+  if (status == 503) {
+    request->send(503, cContentType, cBusy);
+    return;
+  }
+
+  const bool valid = OperationModeNode::parseConfig(_body, settings);
+  {
+    // the scheduler belongs to loop(), updateTask picks the body up within UPDATE_INTERVAL
+    CriticalSection lock;
+    if (valid) {
+      _bodyPending = true;
+    } else {
+      _bodyRequest = nullptr;
+    }
+  }
+  if (valid) {
+    request->send(202, cContentType, cAccepted);
+  } else {
+    request->send(400, cContentType, cInvalidSettings);
+  }
+}
+
+/**
+ * Runs in the web server: track the WebSocket clients, new ones get the full state.
+ */
+void HttpApi::handleSocketEvent(AsyncWebSocketClient* client, const AwsEventType type) {
+  if (type == WS_EVT_CONNECT) {
+    const uint32_t id       = client->id();
+    bool           accepted = false;
+    {
+      CriticalSection lock;
+      _requests++;
+      for (uint8_t i = 0; i < MAX_CLIENTS && !accepted; i++) {
+        if (_clients[i].id == 0) {
+          _clients[i].id     = id;
+          _clients[i].fields = ALL_FIELDS;
+          _clients[i].full   = true;
+          accepted           = true;
+        }
+      }
+      _rejected += accepted ? 0 : 1;
+    }
+    if (!accepted) {
+      client->close(1013);  // try again later, outside of the lock
+    }
+
+  } else if (type == WS_EVT_DISCONNECT) {
+    const uint32_t  id = client->id();
+    CriticalSection lock;
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+      if (_clients[i].id == id) {
+        _clients[i].id = 0;
+      }
+    }
+  }
+  // data from clients is ignored
+}
+
+/**
+ * Runs in loop(): send each client a frame of its pending fields, unless its previous frame is still queued.
+ */
+void HttpApi::push(const uint32_t changes) {
+  _socket->cleanupClients(MAX_CLIENTS);
+
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    uint32_t id;
+    uint32_t fields;
+    bool     full;
+    {
+      CriticalSection lock;
+      _clients[i].fields |= changes;
+      id     = _clients[i].id;
+      fields = _clients[i].fields;
+      full   = _clients[i].full;
+    }
+    if (id == 0 || fields == 0) {
+      continue;
+    }
+
+    AsyncWebSocketClient* client = _socket->client(id);
+    if (client == nullptr || client->status() != WS_CONNECTED || client->queueLen() > 0) {
+      // slow client: the changes add up until the queue is empty
+      continue;
+    }
+
+    const size_t length = renderFrame(_snapshot, fields, full);
+    if (client->text(_frame, length)) {
+      _frames++;
+      CriticalSection lock;
+      if (_clients[i].id == id) {
+        // fields which did not fit stay pending, the full state lasts until its last field is sent
+        _clients[i].fields = fields;
+        _clients[i].full   = full && fields != 0;
+      }
+    }
+  }
+}
+
+/**
+ * Bits of the fields which differ, see FIELD_*.
+ */
+uint32_t HttpApi::changedFields(const Snapshot& snapshot, const Snapshot& previous) {
+  uint32_t     changes    = 0;
+  const size_t properties = OperationModeNode::getPropertyCount();
+
+  for (uint8_t i = 0; i < properties && i < MAX_PROPERTIES; i++) {
+    if (OperationModeNode::getProperty(i).differs(&snapshot.settings, &previous.settings)) {
+      changes |= 1UL << (FIELD_SETTINGS + i);
+    }
+  }
+  for (uint8_t i = 0; i < MAX_SENSORS; i++) {
+    if (snapshot.temperatures[i] != previous.temperatures[i]) {
+      changes |= 1UL << (FIELD_TEMPERATURES + i);
+    }
+  }
+  for (uint8_t i = 0; i < MAX_RELAYS; i++) {
+    if (((snapshot.relays ^ previous.relays) | (snapshot.pending ^ previous.pending)) & (1 << i)) {
+      changes |= 1UL << (FIELD_RELAYS + i);
+    }
+  }
+  if (snapshot.plan != previous.plan) {
+    changes |= 1UL << FIELD_PLAN;
+  }
+  return changes;
+}
+
+static const char cMore[] = ",\"more\":true";  // some fields follow in the next frame
+
+/**
+ * JSON object built from fields grouped in sections; an item which does not fit is left out.
+ */
+class FrameWriter {
+
+public:
+  FrameWriter(char* buffer, const size_t size) : _buffer(buffer), _size(size), _length(0), _section(nullptr) {
+    _buffer[0] = '\0';
+  }
+
+  void begin(const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    vappend(format, arguments);
+    va_end(arguments);
+  }
+
+  bool item(const char* section, const char* format, ...) {
+    const size_t start = _length;
+    bool         fits  = (section == _section) ? put(",") : closeSection() && put(",\"") && put(section) && put("\":{");
+    va_list      arguments;
+    va_start(arguments, format);
+    fits = fits && vappend(format, arguments);
+    va_end(arguments);
+
+    if (!fits) {
+      _length          = start;
+      _buffer[_length] = '\0';
+      return false;
+    }
+    _section = section;
+    return true;
+  }
+
+  size_t end(const bool more) {
+    // room for the braces and the flag is reserved
+    if (_section != nullptr) {
+      _buffer[_length++] = '}';
+    }
+    if (more) {
+      memcpy(_buffer + _length, cMore, sizeof(cMore) - 1);
+      _length += sizeof(cMore) - 1;
+    }
+    _buffer[_length++] = '}';
+    _buffer[_length]   = '\0';
+    return _length;
+  }
+
+private:
+  static const size_t RESERVE = 3 + sizeof(cMore) - 1;  // "}}", '\0' and cMore
+
+  char*       _buffer;
+  size_t      _size;
+  size_t      _length;
+  const char* _section;
+
+  bool closeSection() { return (_section == nullptr) || put("}"); }
+  bool put(const char* text) {
+    const size_t length = strlen(text);
+    if (_length + length + RESERVE > _size) {
+      return false;
+    }
+    memcpy(_buffer + _length, text, length + 1);
+    _length += length;
+    return true;
+  }
+
+  bool vappend(const char* format, va_list arguments) {
+    const size_t room   = _size - RESERVE - _length;
+    const int    length = vsnprintf(_buffer + _length, room + 1, format, arguments);
+    if (length < 0 || (size_t)length > room) {
+      _buffer[_length] = '\0';
+      return false;
+    }
+    _length += length;
+    return true;
+  }
+};
+
+/**
+ * Frame of the fields into _frame; returns its length. Fields which did not fit are left in fields and the frame
+ * is marked with "more":true.
+ */
+size_t HttpApi::renderFrame(const Snapshot& snapshot, uint32_t& fields, const bool full) {
+  FrameWriter  frame(_frame, FRAME_SIZE);
+  const size_t properties = OperationModeNode::getPropertyCount();
+  uint32_t     skipped    = 0;  // did not fit
+
+  frame.begin("{\"full\":%s,\"uptime\":%lu", full ? "true" : "false", (unsigned long)snapshot.uptime);
+
+  for (uint8_t i = 0; i < properties && i < MAX_PROPERTIES; i++) {
+    const uint32_t bit = 1UL << (FIELD_SETTINGS + i);
+    if (fields & bit) {
+      const PropertySpec& spec  = OperationModeNode::getProperty(i);
+      const char*         quote = spec.isText() ? "\"" : "";
+      char                value[PROPERTY_TEXT_SIZE];
+      spec.printFrom(&snapshot.settings, value);
+      if (!frame.item("settings", "\"%s\":%s%s%s", spec.id, quote, value, quote)) {
+        skipped |= bit;
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < _sensorCount; i++) {
+    const uint32_t bit = 1UL << (FIELD_TEMPERATURES + i);
+    char           value[8];
+    if ((fields & bit) &&
+        !frame.item("temperatures", "\"%s\":%s", _sensors[i].getId(), jsonTemperature(snapshot.temperatures[i], value))) {
+      skipped |= bit;
+    }
+  }
+
+  for (uint8_t i = 0; i < _relayCount; i++) {
+    const uint32_t bit = 1UL << (FIELD_RELAYS + i);
+    if ((fields & bit) && !frame.item("relays", "\"%s\":{\"on\":%s,\"pending\":%s}", _relays[i].getId(),
+                                     ((snapshot.relays >> i) & 1) ? "true" : "false",
+                                     ((snapshot.pending >> i) & 1) ? "true" : "false")) {
+      skipped |= bit;
+    }
+  }
+
+  if (fields & (1UL << FIELD_PLAN)) {
+    char plan[FiltrationPlanner::SLOTS + 1];
+    for (uint8_t slot = 0; slot < FiltrationPlanner::SLOTS; slot++) {
+      plan[slot] = ((snapshot.plan >> slot) & 1) ? '1' : '0';
+    }
+    plan[FiltrationPlanner::SLOTS] = '\0';
+    if (!frame.item("schedule", "\"plan\":\"%s\"", plan)) {
+      skipped |= 1UL << FIELD_PLAN;
+    }
+  }
+
+  fields = skipped;
+  return frame.end(skipped != 0);
+}
+
+/**
+ * Free stream buffer, nullptr if all are in use.
+ */
+HttpApi::Stream* HttpApi::acquireStream() {
+  for (uint8_t i = 0; i < MAX_STREAMS; i++) {
+    if (!_streams[i].used) {
+      _streams[i].used = true;
+      return &_streams[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Copy rendered lines into the buffer of the web server; 0 ends the response.
+ */
+size_t HttpApi::fill(Stream& stream, uint8_t* buffer, const size_t size) {
+  size_t written = 0;
+
+  while (written < size) {
+    if (stream.position >= stream.length) {
+      if (stream.done) {
+        break;
+      }
+      int length;
+      switch (stream.kind) {
+      case STREAM_STATE:
+        length = renderState(stream);
+        break;
+      case STREAM_HISTORY:
+        length = renderHistory(stream);
+        break;
+      default:
+        length = renderMetrics(stream);
+        break;
+      }
+      stream.length    = (length < 0) ? 0 : (length < (int)LINE_SIZE) ? length : LINE_SIZE - 1;
+      stream.position  = 0;
+      stream.item++;
+      continue;
+    }
+
+    const size_t count = (size - written < (size_t)(stream.length - stream.position)) ? size - written
+                                                                                        : stream.length - stream.position;
+    memcpy(buffer + written, stream.line + stream.position, count);
+    written += count;
+    stream.position += count;
+  }
+
+  return written;
+}
+
+/**
+ * Next line of /api/state.
+ */
+int HttpApi::renderState(Stream& stream) {
+  const Snapshot& snapshot   = stream.snapshot;
+  const uint16_t  properties = OperationModeNode::getPropertyCount();
+  uint16_t        item       = stream.item;
+
+  if (item == 0) {
+    return snprintf(stream.line, LINE_SIZE, "{\"uptime\":%lu,\"free-heap\":%lu,\"max-block\":%lu,\"settings\":{",
+                    (unsigned long)snapshot.uptime, (unsigned long)snapshot.freeHeap, (unsigned long)snapshot.maxBlock);
+  }
+  item -= 1;
+
+  if (item < properties) {
+    const PropertySpec& spec = OperationModeNode::getProperty(item);
+    const char*         quote = spec.isText() ? "\"" : "";
+    char                value[PROPERTY_TEXT_SIZE];
+    spec.printFrom(&snapshot.settings, value);
+    return snprintf(stream.line, LINE_SIZE, "%s\"%s\":%s%s%s", (item > 0) ? "," : "", spec.id, quote, value, quote);
+  }
+  item -= properties;
+
+  if (item == 0) {
+    const TemperatureThresholds thresholds =
+        makeThresholds(snapshot.settings.poolMax, snapshot.settings.solarMin, snapshot.settings.hysteresis);
+    char poolMaxOff[8];
+    char poolMaxOn[8];
+    char solarMinOff[8];
+    return snprintf(stream.line, LINE_SIZE,
+                    "},\"thresholds\":{\"pool-max-off\":%s,\"pool-max-on\":%s,\"solar-min-off\":%s},\"temperatures\":{",
+                    jsonTemperature(thresholds.poolMaxOff, poolMaxOff), jsonTemperature(thresholds.poolMaxOn, poolMaxOn),
+                    jsonTemperature(thresholds.solarMinOff, solarMinOff));
+  }
+  item -= 1;
+
+  if (item < _sensorCount) {
+    char value[8];
+    return snprintf(stream.line, LINE_SIZE, "%s\"%s\":%s", (item > 0) ? "," : "", _sensors[item].getId(),
+                    jsonTemperature(snapshot.temperatures[item], value));
+  }
+  item -= _sensorCount;
+
+  if (item == 0) {
+    return snprintf(stream.line, LINE_SIZE, "},\"relays\":{");
+  }
+  item -= 1;
+
+  if (item < _relayCount) {
+    return snprintf(stream.line, LINE_SIZE, "%s\"%s\":{\"on\":%s,\"pending\":%s}", (item > 0) ? "," : "",
+                    _relays[item].getId(), ((snapshot.relays >> item) & 1) ? "true" : "false",
+                    ((snapshot.pending >> item) & 1) ? "true" : "false");
+  }
+  item -= _relayCount;
+
+  if (item == 0) {
+    return snprintf(stream.line, LINE_SIZE, "},\"schedule\":{\"timer-start\":\"%02u:%02u\",\"timer-end\":\"%02u:%02u\",",
+                    snapshot.settings.timerStartHour, snapshot.settings.timerStartMinutes, snapshot.settings.timerEndHour,
+                    snapshot.settings.timerEndMinutes);
+  }
+
+  // plan of rule filter, one character per slot
+  char plan[FiltrationPlanner::SLOTS + 1];
+  for (uint8_t slot = 0; slot < FiltrationPlanner::SLOTS; slot++) {
+    plan[slot] = ((snapshot.plan >> slot) & 1) ? '1' : '0';
+  }
+  plan[FiltrationPlanner::SLOTS] = '\0';
+
+  stream.done = true;
+  return snprintf(stream.line, LINE_SIZE, "\"slot-minutes\":%u,\"plan\":\"%s\"}}", FiltrationPlanner::SLOT_SECONDS / 60, plan);
+}
+
+/**
+ * Next line of /api/history.
+ */
+int HttpApi::renderHistory(Stream& stream) {
+  if (stream.item == 0) {
+    return snprintf(stream.line, LINE_SIZE, "{\"interval\":%lu,\"samples\":[", History::INTERVAL / 1000);
+  }
+
+  HistorySample sample;
+  if (!history.get(stream.item - 1, sample)) {
+    stream.done = true;
+    return snprintf(stream.line, LINE_SIZE, "]}");
+  }
+
+  char pool[8];
+  char solar[8];
+  int  length = snprintf(stream.line, LINE_SIZE, "%s{\"age\":%lu,\"pool\":%s,\"solar\":%s,\"relays\":[",
+                         (stream.item > 1) ? "," : "", (unsigned long)(millis() / 1000 - sample.time),
+                         jsonTemperature(sample.pool, pool), jsonTemperature(sample.solar, solar));
+  for (uint8_t i = 0; i < _relayCount && length < (int)LINE_SIZE; i++) {
+    length += snprintf(stream.line + length, LINE_SIZE - length, "%s%u", (i > 0) ? "," : "", (sample.relays >> i) & 1);
+  }
+  if (length < (int)LINE_SIZE) {
+    length += snprintf(stream.line + length, LINE_SIZE - length, "]}");
+  }
+  return length;
+}
+
+/**
+ * Next line of /metrics: the HELP and TYPE comments of a family (together shorter than LINE_SIZE), then one line per
+ * sample.
+ */
+int HttpApi::renderMetrics(Stream& stream) {
+  uint16_t item = stream.item;
+
+  for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+    const size_t samples = getMetricSamples(stream.snapshot, metric);
+    if (samples == 0) {
+      continue;
+    }
+    if (item == 0) {
+      const MetricFamily& family = METRICS[metric];
+      return snprintf(stream.line, LINE_SIZE, "# HELP %s %s\n# TYPE %s %s\n", family.name, family.help, family.name,
+                      family.type);
+    }
+    item -= 1;
+
+    if (item < samples) {
+      return renderMetric(stream, metric, item);
+    }
+    item -= samples;
+  }
+
+  stream.done = true;
+  return 0;
+}
+
+/**
+ * Number of samples of a metric family.
+ */
+size_t HttpApi::getMetricSamples(const Snapshot& snapshot, const uint8_t metric) const {
+  switch (metric) {
+  case METRIC_TEMPERATURE:
+    return _sensorCount;
+  case METRIC_RELAY_ON:
+  case METRIC_RELAY_PENDING:
+  case METRIC_RELAY_CYCLES:
+  case METRIC_RELAY_RUNTIME:
+    return _relayCount;
+  case METRIC_MODE: {
+    const char* format = modeProperty().format;
+    size_t      count  = 1;
+    for (; *format != '\0'; format++) {
+      count += (*format == ',') ? 1 : 0;
+    }
+    return count;
+  }
+  case METRIC_SETTING:
+    return OperationModeNode::getPropertyCount();
+  case METRIC_LATENESS:
+    return snapshot.taskCount * 2;  // average, maximum
+  case METRIC_DURATION:
+    return snapshot.slotCount * 3;  // median, 99th percentile, maximum
+  default:
+    return 1;
+  }
+}
+
+/**
+ * One sample line of a metric family. Scheduler and profiler come from the copies of update(), each line from one
+ * consistent entry.
+ */
+int HttpApi::renderMetric(Stream& stream, const uint8_t metric, const uint16_t sample) {
+  const Snapshot& snapshot = stream.snapshot;
+  const char*     name     = METRICS[metric].name;
+  char            value[PROPERTY_TEXT_SIZE];
+
+  switch (metric) {
+  case METRIC_UPTIME:
+    return snprintf(stream.line, LINE_SIZE, "%s %lu\n", name, (unsigned long)snapshot.uptime);
+  case METRIC_FREE_HEAP:
+    return snprintf(stream.line, LINE_SIZE, "%s %lu\n", name, (unsigned long)snapshot.freeHeap);
+  case METRIC_MAX_BLOCK:
+    return snprintf(stream.line, LINE_SIZE, "%s %lu\n", name, (unsigned long)snapshot.maxBlock);
+  case METRIC_MIN_FREE_HEAP:
+    return snprintf(stream.line, LINE_SIZE, "%s %lu\n", name, (unsigned long)snapshot.minFreeHeap);
+  case METRIC_FRAGMENTATION:
+    return snprintf(stream.line, LINE_SIZE, "%s %u\n", name, snapshot.fragmentation);
+  case METRIC_RSSI:
+    return snprintf(stream.line, LINE_SIZE, "%s %d\n", name, snapshot.rssi);
+  case METRIC_SYNC_AGE:
+    if (snapshot.syncAge < 0) {
+      return snprintf(stream.line, LINE_SIZE, "%s NaN\n", name);
+    }
+    return snprintf(stream.line, LINE_SIZE, "%s %ld\n", name, (long)snapshot.syncAge);
+
+  case METRIC_TEMPERATURE:
+    return snprintf(stream.line, LINE_SIZE, "%s{node=\"%s\"} %s\n", name, _sensors[sample].getId(),
+                    metricTemperature(snapshot.temperatures[sample], value));
+  case METRIC_RELAY_ON:
+    return snprintf(stream.line, LINE_SIZE, "%s{node=\"%s\"} %u\n", name, _relays[sample].getId(),
+                    (snapshot.relays >> sample) & 1);
+  case METRIC_RELAY_PENDING:
+    return snprintf(stream.line, LINE_SIZE, "%s{node=\"%s\"} %u\n", name, _relays[sample].getId(),
+                    (snapshot.pending >> sample) & 1);
+  case METRIC_RELAY_CYCLES:
+    return snprintf(stream.line, LINE_SIZE, "%s{node=\"%s\"} %lu\n", name, _relays[sample].getId(),
+                    (unsigned long)snapshot.cycles[sample]);
+  case METRIC_RELAY_RUNTIME:
+    return snprintf(stream.line, LINE_SIZE, "%s{node=\"%s\"} %lu\n", name, _relays[sample].getId(),
+                    (unsigned long)snapshot.runtime[sample]);
+
+  case METRIC_MODE:
+    if (!listValue(modeProperty().format, sample, value, sizeof(value))) {
+      return 0;
+    }
+    return snprintf(stream.line, LINE_SIZE, "%s{mode=\"%s\"} %u\n", name, value,
+                    strcmp(snapshot.settings.mode, value) == 0 ? 1 : 0);
+  case METRIC_SETTING: {
+    const PropertySpec& spec = OperationModeNode::getProperty(sample);
+    if (spec.isText()) {
+      return 0;
+    }
+    spec.printFrom(&snapshot.settings, value);
+    return snprintf(stream.line, LINE_SIZE, "%s{setting=\"%s\"} %s\n", name, spec.id, value);
+  }
+
+  case METRIC_LATENESS: {
+    Counters counters;
+    {
+      CriticalSection lock;
+      counters = _taskCounters[sample / 2];
+    }
+    const bool average = (sample % 2) == 0;
+    return snprintf(stream.line, LINE_SIZE, "%s{task=\"%s\",stat=\"%s\"} %lu\n", name, counters.name, average ? "avg" : "max",
+                    (unsigned long)counters.values[sample % 2]);
+  }
+  case METRIC_DURATION: {
+#if LOOP_PROFILER
+    static const char* quantiles[] = {"0.5", "0.99", "1"};
+    Counters           counters;
+    {
+      CriticalSection lock;
+      counters = _slotCounters[sample / 3];
+    }
+    return snprintf(stream.line, LINE_SIZE, "%s{task=\"%s\",kind=\"%s\",quantile=\"%s\"} %lu\n", name, counters.name,
+                    counters.kind, quantiles[sample % 3], (unsigned long)counters.values[sample % 3]);
+#else
+    return 0;
+#endif
+  }
+
+  case METRIC_REQUESTS:
+    return snprintf(stream.line, LINE_SIZE, "%s %lu\n", name, (unsigned long)_requests);
+  case METRIC_REJECTED:
+    return snprintf(stream.line, LINE_SIZE, "%s %lu\n", name, (unsigned long)_rejected);
+  default:
+    return 0;
+  }
+}
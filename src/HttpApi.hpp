@@ -0,0 +1,193 @@
+/**
+ * Local HTTP JSON API for clients on the LAN, without the MQTT broker.
+ *
+ *   GET  /api/state     mode, settings, thresholds, temperatures, relays, schedule
+ *   GET  /api/history   samples of History, oldest first
+ *   GET  /api/heap      free heap and largest block, without a stream buffer
+ *   POST /api/settings  JSON object like the property "config" of OperationModeNode
+ *   WS   /api/live      full state on connect, then frames with the changed fields
+ *   GET  /metrics       Prometheus text format
+ *
+ * Responses are chunked and rendered line by line from one of MAX_STREAMS
+ * fixed buffers; without a free buffer a request is answered with 503. The
+ * web server runs outside of loop() (its own task on the ESP32), so it only
+ * reads a snapshot of the state, which a scheduler task refreshes every
+ * UPDATE_INTERVAL. Settings are validated right away and applied by that task
+ * through OperationModeNode::updateConfig(), the same path as MQTT input.
+ *
+ * The same task compares the new snapshot with the previous one and pushes the
+ * changed fields to the WebSocket clients, at most MAX_CLIENTS of them. A
+ * client gets a new frame only when its previous one has left the queue;
+ * meanwhile its changes are collected and sent as one frame with the latest
+ * values. Frames are at most FRAME_SIZE bytes, fields which do not fit follow
+ * in the next frame ("more":true), so a connection never holds more than one
+ * frame of heap.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "OperationModeNode.hpp"
+#include "DallasTemperatureNode.hpp"
+#include "RelayModuleNode.hpp"
+#include "FiltrationPlanner.hpp"
+#include "SettingsStore.hpp"
+#include "DeadlineScheduler.hpp"
+#include "NodeStrings.hpp"
+
+class HttpApi {
+
+public:
+  static const uint8_t       MAX_SENSORS     = 4;
+  static const uint8_t       MAX_RELAYS      = 8;
+  static const uint8_t       MAX_STREAMS     = 2;     // concurrent responses
+  static const size_t        LINE_SIZE       = 128;   // longest rendered line
+  static const size_t        BODY_SIZE       = 384;   // settings request
+  static const unsigned long UPDATE_INTERVAL = 1000;  // in ms
+  static const uint8_t       MAX_CLIENTS     = 3;     // WebSocket
+  static const size_t        FRAME_SIZE      = 512;
+  static const size_t        HEAP_SIZE       = 128;  // response of /api/heap
+
+  HttpApi();
+
+  void setOperationModeNode(OperationModeNode* node) { _operationModeNode = node; }
+  void setSensors(DallasTemperatureNode* nodes, const uint8_t count);
+  void setRelays(RelayModuleNode* nodes, const uint8_t count);
+  void setPlanner(FiltrationPlanner* planner) { _planner = planner; }
+
+  void begin(const uint16_t port);
+  bool isRunning() const { return _server != nullptr; }
+
+  uint32_t getRequestCount() const { return _requests; }
+  uint32_t getRejectedCount() const { return _rejected; }
+  uint32_t getFrameCount() const { return _frames; }
+
+private:
+  static const char cContentType[];
+  static const char cMetricsContentType[];
+  static const char cNotFound[];
+  static const char cBusy[];
+  static const char cTooLarge[];
+  static const char cInvalidSettings[];
+  static const char cAccepted[];
+
+  /**
+   * State as seen by the web server, copied in loop().
+   */
+  struct Snapshot {
+    uint32_t        uptime;  // in s
+    uint32_t        freeHeap;
+    uint32_t        maxBlock;
+    uint32_t        minFreeHeap;
+    uint8_t         fragmentation;  // in %
+    int8_t          rssi;           // in dBm
+    int32_t         syncAge;        // in s, -1 before the first NTP sync
+    ControlSettings settings;
+    int16_t         temperatures[MAX_SENSORS];
+    uint8_t         relays;   // bit per relay: on
+    uint8_t         pending;  // bit per relay: switch queued
+    uint32_t        cycles[MAX_RELAYS];
+    uint32_t        runtime[MAX_RELAYS];  // in s
+    uint64_t        plan;                 // bit per slot of FiltrationPlanner
+    uint8_t         taskCount;            // entries of _taskCounters
+    uint8_t         slotCount;            // entries of _slotCounters
+  };
+
+  /**
+   * Scheduler task or profiler slot as rendered by /metrics, copied in loop() entry by entry.
+   */
+  struct Counters {
+    const char* name;
+    const char* kind;       // profiler slots only
+    uint32_t    values[3];  // task: average and maximum lateness; slot: median, 99th percentile and maximum
+  };
+
+  enum StreamKind : uint8_t { STREAM_STATE, STREAM_HISTORY, STREAM_METRICS };
+
+  // bits of the changed fields of a snapshot
+  static const uint8_t  FIELD_SETTINGS     = 0;  // one per property
+  static const uint8_t  MAX_PROPERTIES     = 12;
+  static const uint8_t  FIELD_TEMPERATURES = FIELD_SETTINGS + MAX_PROPERTIES;
+  static const uint8_t  FIELD_RELAYS       = FIELD_TEMPERATURES + MAX_SENSORS;
+  static const uint8_t  FIELD_PLAN         = FIELD_RELAYS + MAX_RELAYS;
+  static const uint32_t ALL_FIELDS         = (1UL << (FIELD_PLAN + 1)) - 1;
+  static_assert(FIELD_PLAN < 32, "too many fields for the change mask");
+
+  /**
+   * WebSocket client and the fields it has not been sent yet.
+   */
+  struct LiveClient {
+    uint32_t id;  // 0 if unused
+    uint32_t fields;
+    bool     full;  // pending fields belong to the full state
+  };
+
+  /**
+   * One response in progress.
+   */
+  struct Stream {
+    bool       used;
+    StreamKind kind;
+    uint16_t   item;      // next line to render
+    uint8_t    length;    // of line
+    uint8_t    position;  // already sent of line
+    bool       done;      // last line rendered
+    char       line[LINE_SIZE];
+    Snapshot   snapshot;
+  };
+
+  AsyncWebServer* _server;
+  AsyncWebSocket* _socket;
+
+  OperationModeNode*     _operationModeNode;
+  DallasTemperatureNode* _sensors;
+  uint8_t                _sensorCount;
+  RelayModuleNode*       _relays;
+  uint8_t                _relayCount;
+  FiltrationPlanner*     _planner;
+
+  int8_t   _updateTask;
+  Snapshot _snapshot;
+  Counters _taskCounters[DeadlineScheduler::MAX_TASKS];
+#if LOOP_PROFILER
+  Counters _slotCounters[LoopProfiler::MAX_SLOTS];
+#endif
+  Stream _streams[MAX_STREAMS];
+
+  AsyncWebServerRequest* _bodyRequest;  // receiving into _body
+  char                   _body[BODY_SIZE];
+  size_t                 _bodyLength;
+  bool                   _bodyPending;  // validated, waiting for updateTask
+
+  LiveClient _clients[MAX_CLIENTS];
+  char       _frame[FRAME_SIZE];
+
+  uint32_t _requests;
+  uint32_t _rejected;  // no free stream or body buffer, too many clients
+  uint32_t _frames;
+
+  void        update();
+  static void updateTask(void* api) { static_cast<HttpApi*>(api)->update(); }
+
+  void    handleStream(AsyncWebServerRequest* request, const StreamKind kind);
+  void    handleHeap(AsyncWebServerRequest* request);
+  void    handleBody(AsyncWebServerRequest* request, const uint8_t* data, const size_t length, const size_t index,
+                     const size_t total);
+  void    handleSettings(AsyncWebServerRequest* request);
+  void    handleSocketEvent(AsyncWebSocketClient* client, const AwsEventType type);
+  void    push(const uint32_t changes);
+  size_t  renderFrame(const Snapshot& snapshot, uint32_t& fields, const bool full);
+  Stream* acquireStream();
+  size_t  fill(Stream& stream, uint8_t* buffer, const size_t size);
+  int     renderState(Stream& stream);
+  int     renderHistory(Stream& stream);
+  int     renderMetrics(Stream& stream);
+  int     renderMetric(Stream& stream, const uint8_t metric, const uint16_t sample);
+  size_t  getMetricSamples(const Snapshot& snapshot, const uint8_t metric) const;
+
+  static uint32_t changedFields(const Snapshot& snapshot, const Snapshot& previous);
+};
+
+extern HttpApi httpApi;
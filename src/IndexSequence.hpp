@@ -0,0 +1,19 @@
+/**
+ * Compile-time index lists to expand constexpr tables into array initializers.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// C++11 has no std::index_sequence
+template <size_t... I>
+struct IndexSequence {};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...> {
+  typedef IndexSequence<I...> type;
+};
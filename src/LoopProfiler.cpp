@@ -0,0 +1,122 @@
+/**
+ * Wall time profiler of the main loop work.
+ */
+#include "LoopProfiler.hpp"
+#include <Homie.hpp>
+#include "NodeStrings.hpp"
+
+#if LOOP_PROFILER
+
+LoopProfiler loopProfiler;
+
+/**
+ *
+ */
+LoopProfiler::LoopProfiler() {
+  _slotCount = 0;
+}
+
+/**
+ * Returns the slot or INVALID_SLOT if all slots are taken; recording into INVALID_SLOT is ignored.
+ *
+ * @param name  e.g. the node id
+ * @param kind  what is measured, e.g. "loop" or "input"
+ */
+int8_t LoopProfiler::addSlot(const char* name, const char* kind) {
+  if (_slotCount >= MAX_SLOTS) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ profiler full, ") << name << F(" (") << kind << F(") is not measured") << endl;
+    return INVALID_SLOT;
+  }
+
+  Slot& s = _slots[_slotCount];
+  s.name  = name;
+  s.kind  = kind;
+  memset(s.buckets, 0, sizeof(s.buckets));
+  s.count = 0;
+  s.max   = 0;
+
+  return _slotCount++;
+}
+
+/**
+ * @param duration  in us
+ */
+void LoopProfiler::record(const int8_t slot, const uint32_t duration) {
+  if (slot < 0 || slot >= _slotCount) {
+    return;
+  }
+
+  Slot&         s      = _slots[slot];
+  const uint8_t bucket = bucketOf(duration);
+
+  if (s.buckets[bucket] == UINT16_MAX) {
+    // keep the shape of the distribution instead of overflowing
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      s.buckets[i] /= 2;
+    }
+  }
+  s.buckets[bucket]++;
+  s.count++;
+  if (duration > s.max) {
+    s.max = duration;
+  }
+}
+
+/**
+ * Upper limit of the bucket holding the percentile, in us; never more than the maximum.
+ */
+uint32_t LoopProfiler::getPercentile(const int8_t slot, const uint8_t percent) const {
+  const Slot& s     = _slots[slot];
+  uint32_t    total = 0;
+
+  for (uint8_t i = 0; i < BUCKETS; i++) {
+    total += s.buckets[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  const uint32_t target = (total * percent + 99) / 100;
+  uint32_t       seen   = 0;
+  for (uint8_t i = 0; i < BUCKETS - 1; i++) {
+    seen += s.buckets[i];
+    if (seen >= target) {
+      return (bucketLimit(i) < s.max) ? bucketLimit(i) : s.max;
+    }
+  }
+
+  return s.max;
+}
+
+/**
+ * Start a new measuring window for all slots.
+ */
+void LoopProfiler::reset() {
+  for (uint8_t i = 0; i < _slotCount; i++) {
+    memset(_slots[i].buckets, 0, sizeof(_slots[i].buckets));
+    _slots[i].count = 0;
+    _slots[i].max   = 0;
+  }
+}
+
+/**
+ *
+ */
+uint8_t LoopProfiler::bucketOf(const uint32_t duration) {
+  const uint32_t units = duration >> 7;
+  if (units < 2) {
+    return 0;
+  }
+
+  const uint8_t bucket = 31 - __builtin_clz(units);
+  return (bucket < BUCKETS) ? bucket : BUCKETS - 1;
+}
+
+/**
+ *
+ */
+ProfileScope::~ProfileScope() {
+  loopProfiler.record(_slot, micros() - _start);
+}
+
+#endif
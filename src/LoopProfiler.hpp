@@ -0,0 +1,83 @@
+/**
+ * Wall time profiler of the main loop work.
+ *
+ * Every profiled scope (scheduler task, handleInput(), rule evaluation, ...)
+ * owns a slot with a histogram of fixed log-scale buckets: bucket 0 counts
+ * durations below 256 us, bucket n durations below 256 us << n, the last
+ * bucket everything from about 4 s on. Recording is a shift and an increment,
+ * cheap enough to stay enabled; p50/p99 are read from the buckets and
+ * reported as the bucket's upper limit.
+ *
+ * Build with -D LOOP_PROFILER=0 to compile the profiler out entirely,
+ * PROFILE_SCOPE() is empty then.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef LOOP_PROFILER
+#define LOOP_PROFILER 1
+#endif
+
+#if LOOP_PROFILER
+
+class LoopProfiler {
+
+public:
+  static const uint8_t MAX_SLOTS    = 26;  // one per scheduler task, input handlers, rule and Homie loop
+  static const uint8_t BUCKETS      = 16;
+  static const int8_t  INVALID_SLOT = -1;
+
+  LoopProfiler();
+
+  int8_t addSlot(const char* name, const char* kind);
+  void   record(const int8_t slot, const uint32_t duration);
+
+  uint8_t     getSlotCount() const { return _slotCount; }
+  const char* getName(const int8_t slot) const { return _slots[slot].name; }
+  const char* getKind(const int8_t slot) const { return _slots[slot].kind; }
+  uint32_t    getCount(const int8_t slot) const { return _slots[slot].count; }
+  uint32_t    getMax(const int8_t slot) const { return _slots[slot].max; }
+  uint32_t    getPercentile(const int8_t slot, const uint8_t percent) const;
+  void        reset();
+
+private:
+  struct Slot {
+    const char* name;
+    const char* kind;
+    uint16_t    buckets[BUCKETS];
+    uint32_t    count;  // number of records
+    uint32_t    max;    // in us
+  };
+
+  Slot    _slots[MAX_SLOTS];
+  uint8_t _slotCount;
+
+  static uint8_t  bucketOf(const uint32_t duration);
+  static uint32_t bucketLimit(const uint8_t bucket) { return 256UL << bucket; }
+};
+
+/**
+ * Records the lifetime of the object into a slot.
+ */
+class ProfileScope {
+
+public:
+  explicit ProfileScope(const int8_t slot) : _slot(slot), _start(micros()) {}
+  ~ProfileScope();
+
+private:
+  const int8_t   _slot;
+  const uint32_t _start;
+};
+
+extern LoopProfiler loopProfiler;
+
+#define PROFILE_SCOPE(slot) ProfileScope profileScope_(slot)
+
+#else
+
+#define PROFILE_SCOPE(slot)
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * Strings shared by all nodes and rules.
+ */
+#include "NodeStrings.hpp"
+
+const char cIndent[] PROGMEM = "  ◦ ";
+
+const char cHomieNodeState[]     = "state";
+const char cHomieNodeStateName[] = "State";
+
+const char cHomieNodeState_OK[]    = "OK";
+const char cHomieNodeState_Error[] = "Error";
+
+const char cTemperature[]     = "temperature";
+const char cTemperatureName[] = "Temperature";
+const char cTemperatureUnit[] = "°C";
+
+const char cFlagOn[]  = "true";
+const char cFlagOff[] = "false";
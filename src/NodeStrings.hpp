@@ -0,0 +1,30 @@
+/**
+ * Strings shared by all nodes and rules.
+ *
+ * One copy per firmware instead of a const char* member per instance. Texts
+ * which are only logged live in flash (PROGMEM), print them with FPSTR().
+ * Property ids, names and values stay in RAM: Homie keeps these pointers and
+ * reads them like ordinary strings.
+ *
+ * Node specific strings are static class members defined next to the node.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// log output, PROGMEM
+extern const char cIndent[];
+
+// Homie properties and values
+extern const char cHomieNodeState[];
+extern const char cHomieNodeStateName[];
+extern const char cHomieNodeState_OK[];
+extern const char cHomieNodeState_Error[];
+
+extern const char cTemperature[];
+extern const char cTemperatureName[];
+extern const char cTemperatureUnit[];
+
+extern const char cFlagOn[];
+extern const char cFlagOff[];
@@ -4,6 +4,35 @@
 #include "RuleAuto.hpp"
 #include "RuleBoost.hpp"
 
+const char OperationModeNode::STATUS_AUTO[]    = "auto";
+const char OperationModeNode::STATUS_MANU[]    = "manu";
+const char OperationModeNode::STATUS_BOOST[]   = "boost";
+const char OperationModeNode::STATUS_TIMER[]   = "timer";
+const char OperationModeNode::STATUS_FILTER[]  = "filter";
+const char OperationModeNode::STATUS_PREDICT[] = "predict";
+const char OperationModeNode::cCaption[] PROGMEM = "• Operation Status:";
+
+const char OperationModeNode::cConfig[]           = "config";
+const char OperationModeNode::cConfigName[]       = "Settings (JSON)";
+
+// settable properties, the fields of ControlSettings
+static constexpr PropertySpec PROPERTIES[] = {
+    enumProperty("mode", "Operation Mode", "manu,auto,boost,timer,filter,predict", offsetof(ControlSettings, mode),
+                 sizeof(ControlSettings::mode)),
+    temperatureProperty("pool-max-temp", "Max. Pool Temperature", "0:40", "°C", offsetof(ControlSettings, poolMax)),
+    temperatureProperty("solar-min-temp", "Min. Solar Temperature", "0:100", "°C", offsetof(ControlSettings, solarMin)),
+    temperatureProperty("hysteresis", "Hysterese", "0:10", "K", offsetof(ControlSettings, hysteresis)),
+    byteProperty("timer-start-h", "Timer Start", "0:23", "hh", offsetof(ControlSettings, timerStartHour)),
+    byteProperty("timer-start-min", "Timer Start", "0:59", "MM", offsetof(ControlSettings, timerStartMinutes)),
+    byteProperty("timer-end-h", "Timer End", "0:23", "hh", offsetof(ControlSettings, timerEndHour)),
+    byteProperty("timer-end-min", "Timer End", "0:59", "MM", offsetof(ControlSettings, timerEndMinutes)),
+};
+
+typedef PropertyRegistry<sizeof(PROPERTIES) / sizeof(PROPERTIES[0]), 20> Properties;
+static_assert(Properties::bucketsUnique(PROPERTIES), "property ids collide in the hash table, change the number of buckets");
+
+static constexpr Properties properties(PROPERTIES);
+
 /**
  *
  */
@@ -11,7 +40,14 @@ OperationModeNode::OperationModeNode(const char* id, const char* name, const int
     : HomieNode(id, name, "switch") {
 
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = 0;
+  _thresholds          = makeThresholds(0, 0, 0);
+  _evaluationTask      = DeadlineScheduler::INVALID_TASK;
+  _firstDecision       = 0;
+  _publishedValid      = false;
+#if LOOP_PROFILER
+  _inputProfile = LoopProfiler::INVALID_SLOT;
+  _ruleProfile  = LoopProfiler::INVALID_SLOT;
+#endif
 
   //setRunLoopDisconnected(true);
 }
@@ -19,8 +55,72 @@ OperationModeNode::OperationModeNode(const char* id, const char* name, const int
 /**
  *
  */
-void OperationModeNode::addRule(Rule* rule) {
-  _ruleVec.PushBack(rule);
+void OperationModeNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.setInterval(_evaluationTask, _measurementInterval * 1000UL);
+}
+
+/**
+ *
+ */
+void OperationModeNode::setPoolMaxTemperature(int16_t temp) {
+  _thresholds = makeThresholds(temp, _thresholds.solarMin, _thresholds.hysteresis);
+}
+
+/**
+ *
+ */
+void OperationModeNode::setSolarMinTemperature(int16_t temp) {
+  _thresholds = makeThresholds(_thresholds.poolMax, temp, _thresholds.hysteresis);
+}
+
+/**
+ *
+ */
+void OperationModeNode::setTemperatureHysteresis(int16_t temp) {
+  _thresholds = makeThresholds(_thresholds.poolMax, _thresholds.solarMin, temp);
+}
+
+/**
+ * The settings which may be changed via MQTT, to persist them.
+ */
+ControlSettings OperationModeNode::getSettings() {
+  ControlSettings settings;
+  memset(&settings, 0, sizeof(settings));
+
+  strncpy(settings.mode, _mode.c_str(), sizeof(settings.mode) - 1);
+  settings.poolMax           = _thresholds.poolMax;
+  settings.solarMin          = _thresholds.solarMin;
+  settings.hysteresis        = _thresholds.hysteresis;
+  settings.timerStartHour    = _timerSetting.timerStartHour;
+  settings.timerStartMinutes = _timerSetting.timerStartMinutes;
+  settings.timerEndHour      = _timerSetting.timerEndHour;
+  settings.timerEndMinutes   = _timerSetting.timerEndMinutes;
+  return settings;
+}
+
+/**
+ *
+ */
+void OperationModeNode::applySettings(const ControlSettings& settings) {
+  setMode(settings.mode);
+  _thresholds = makeThresholds(settings.poolMax, settings.solarMin, settings.hysteresis);
+
+  _timerSetting.timerStartHour    = settings.timerStartHour;
+  _timerSetting.timerStartMinutes = settings.timerStartMinutes;
+  _timerSetting.timerEndHour      = settings.timerEndHour;
+  _timerSetting.timerEndMinutes   = settings.timerEndMinutes;
+}
+
+/**
+ * Rules are not owned by the node, they must outlive it. False if MAX_RULES is reached.
+ */
+bool OperationModeNode::addRule(Rule* rule) {
+  if (!_rules.push_back(rule)) {
+    Homie.getLogger() << F("✖ addRule: too many rules, ") << rule->getMode() << F(" ignored") << endl;
+    return false;
+  }
+  return true;
 }
 
 /**
@@ -29,19 +129,17 @@ void OperationModeNode::addRule(Rule* rule) {
 Rule* OperationModeNode::getRule() {
   Homie.getLogger() << F("getRule: mode=") << _mode << endl;
 
-  for (int i = 0; i < _ruleVec.Size(); i++) {
-    if (_mode.equals(_ruleVec[i]->getMode())) {
-      Homie.getLogger() << F("getRule: Active Rule: ") << _ruleVec[i]->getMode() << endl;
+  for (uint8_t i = 0; i < _rules.size(); i++) {
+    if (_mode.equals(_rules[i]->getMode())) {
+      Homie.getLogger() << F("getRule: Active Rule: ") << _rules[i]->getMode() << endl;
       //update the properties
-      _ruleVec[i]->setPoolMaxTemperature(getPoolMaxTemperature());
-      _ruleVec[i]->setSolarMinTemperature(getSolarMinTemperature());
-      _ruleVec[i]->setTemperatureHysteresis(getTemperatureHysteresis());
-      _ruleVec[i]->setTimerSetting(getTimerSetting());
+      _rules[i]->setThresholds(_thresholds);
+      _rules[i]->setTimerSetting(getTimerSetting());
 
-      _ruleVec[i]->setPoolTemperature(_currentPoolTempNode->getTemperature());
-      _ruleVec[i]->setSolarTemperature(_currentSolarTempNode->getTemperature());
+      _rules[i]->setPoolTemperature(_currentPoolTempNode->getTemperature());
+      _rules[i]->setSolarTemperature(_currentSolarTempNode->getTemperature());
 
-      return _ruleVec[i];
+      return _rules[i];
     }
   }
 
@@ -54,22 +152,33 @@ Rule* OperationModeNode::getRule() {
 bool OperationModeNode::setMode(String mode) {
   bool retval;
 
-  if (mode.equals(STATUS_AUTO) || mode.equals(STATUS_MANU) || mode.equals(STATUS_BOOST) || mode.equals(STATUS_TIMER)) {
+  if (isMode(mode.c_str())) {
     _mode = mode;
     Homie.getLogger() << F("set mode: ") << _mode << endl;
-    setProperty(cMode).send(_mode);
-    setProperty(cHomieNodeState).send(cHomieNodeState_OK);
+    if (Homie.isConnected()) {
+      setProperty(cHomieNodeState).send(cHomieNodeState_OK);
+    }
     retval = true;
 
   } else {
     Homie.getLogger() << F("✖ UNDEFINED Mode: ") << mode << F(" Current unchanged mode: ") << _mode << endl;
-    setProperty(cHomieNodeState).send(cHomieNodeState_Error);
+    if (Homie.isConnected()) {
+      setProperty(cHomieNodeState).send(cHomieNodeState_Error);
+    }
     retval = false;
   }
 
   return retval;
 }
 
+/**
+ *
+ */
+bool OperationModeNode::isMode(const char* mode) {
+  return strcmp(mode, STATUS_AUTO) == 0 || strcmp(mode, STATUS_MANU) == 0 || strcmp(mode, STATUS_BOOST) == 0 ||
+         strcmp(mode, STATUS_TIMER) == 0 || strcmp(mode, STATUS_FILTER) == 0 || strcmp(mode, STATUS_PREDICT) == 0;
+}
+
 /**
  *
  */
@@ -83,125 +192,222 @@ String OperationModeNode::getMode() {
 void OperationModeNode::setup() {
 
   advertise(cHomieNodeState).setName(cHomieNodeStateName);
-  advertise(cMode).setName(cModeName).setDatatype("enum").setFormat("manu,auto,boost,timer").settable();
-  advertise(cPoolMaxTemp).setName(cPoolMaxTempName).setDatatype("float").setFormat("0:40").setUnit("°C").settable();
-  advertise(cSolarMinTemp).setName(cSolarMinTempName).setDatatype("float").setFormat("0:100").setUnit("°C").settable();
-  advertise(cHysteresis).setName(cHysteresisName).setDatatype("float").setFormat("0:10").setUnit("K").settable();
-
-  advertise(cTimerStartHour).setName("Timer Start").setDatatype("float").setFormat("0:23").setUnit("hh").settable();
-  advertise(cTimerStartMin).setName("Timer Start").setDatatype("float").setFormat("0:59").setUnit("MM").settable();
-
-  advertise(cTimerEndHour).setName("Timer End").setDatatype("float").setFormat("0:23").setUnit("hh").settable();
-  advertise(cTimerEndMin).setName("Timer End").setDatatype("float").setFormat("0:59").setUnit("MM").settable();
+  for (const PropertySpec& spec : properties) {
+    auto& property = advertise(spec.id).setName(spec.name).setDatatype(spec.datatype).setFormat(spec.format).settable();
+    if (spec.unit != nullptr) {
+      property.setUnit(spec.unit);
+    }
+  }
+  advertise(cConfig).setName(cConfigName).setDatatype("string").settable();
+
+  _evaluationTask = scheduler.addPeriodic(getId(), evaluateTask, this, _measurementInterval * 1000UL);
+#if SENSOR_TASK
+  scheduler.addPeriodic("sensor-queue", [](void*) { sensorTask.drain(); }, nullptr, SensorTask::SAMPLE_INTERVAL);
+#endif
+#if LOOP_PROFILER
+  _inputProfile = loopProfiler.addSlot(getId(), "input");
+  _ruleProfile  = loopProfiler.addSlot(getId(), "rule");
+#endif
 }
 
 /**
  *
  */
-void OperationModeNode::loop() {
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-    Homie.getLogger() << F("〽 OperatioalMode update rule ") << endl;
-    //call loop to evaluate the current rule
-    Rule* rule = getRule();
-    if( rule != nullptr) {
-      rule->loop();
-    } else {
-      Homie.getLogger() << cIndent << F("✖ no rule defined: ") << _mode << endl;
+void OperationModeNode::evaluate() {
+#if SENSOR_TASK
+  // latest readings of the sensor task
+  sensorTask.drain();
+#endif
+  Homie.getLogger() << F("〽 OperatioalMode update rule ") << endl;
+  //call loop to evaluate the current rule
+  Rule* rule = getRule();
+  if( rule != nullptr) {
+    PROFILE_SCOPE(_ruleProfile);
+    rule->loop();
+
+    if (_firstDecision == 0) {
+      _firstDecision = millis();
+      Homie.getLogger() << FPSTR(cIndent) << F("First control decision after ") << _firstDecision << F(" ms") << endl;
     }
-    if (Homie.isConnected()) {
+  } else {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ no rule defined: ") << _mode << endl;
+  }
+  if (Homie.isConnected()) {
 /*
-      Homie.getLogger() << cIndent << F("mode: ") << _mode << endl;
-      Homie.getLogger() << cIndent << F("SolarMinTemp: ") << _solarMinTemp << endl;
-      Homie.getLogger() << cIndent << F("PoolMaxTemp:  ") << _poolMaxTemp << endl;
-      Homie.getLogger() << cIndent << F("Hysteresis:   ") << _hysteresis << endl;
+    Homie.getLogger() << FPSTR(cIndent) << F("mode: ") << _mode << endl;
+    Homie.getLogger() << FPSTR(cIndent) << F("SolarMinTemp: ") << CentiDegrees(_thresholds.solarMin) << endl;
+    Homie.getLogger() << FPSTR(cIndent) << F("PoolMaxTemp:  ") << CentiDegrees(_thresholds.poolMax) << endl;
+    Homie.getLogger() << FPSTR(cIndent) << F("Hysteresis:   ") << CentiDegrees(_thresholds.hysteresis) << endl;
 */
-      setProperty(cMode).send(_mode);
-      setProperty(cSolarMinTemp).send(String(_solarMinTemp));
-      setProperty(cPoolMaxTemp).send(String(_poolMaxTemp));
-      setProperty(cHysteresis).send(String(_hysteresis));
+    publishSettings();
+  } else {
+    Homie.getLogger() << F("✖ OperationalMode: not connected.") << endl;
+    _publishedValid = false;
+  }
+}
+
+/**
+ * Handle update by Homie message.
+ */
+bool OperationModeNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+  PROFILE_SCOPE(_inputProfile);
+  printCaption();
+
+  Homie.getLogger() << FPSTR(cIndent) << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
+  return updateSettings(property.c_str(), value.c_str());
+}
+
+/**
+ * Change one property or, with property "config", several at once. Valid changes are
+ * persisted and evaluated; invalid ones change nothing and set the node state to error.
+ */
+bool OperationModeNode::updateSettings(const char* property, const char* value) {
+  ControlSettings settings = getSettings();
+  bool            retval;
 
-      setProperty(cTimerStartHour).send(String(_timerSetting.timerStartHour));
-      setProperty(cTimerStartMin).send(String(_timerSetting.timerStartMinutes));
+  if (strcasecmp(property, cConfig) == 0) {
+    retval = parseConfig(value, settings);
+  } else {
+    // a single field, the others keep their values
+    retval = setField(settings, property, value) && timerValid(getSettings(), settings);
+  }
 
-      setProperty(cTimerEndHour).send(String(_timerSetting.timerEndHour));
-      setProperty(cTimerEndMin).send(String(_timerSetting.timerEndMinutes));
+  if (retval) {
+    applySettings(settings);
+    settingsStore.update(getSettings());
+    // several updates in a row cause a single evaluation
+    scheduler.trigger(_evaluationTask, COALESCE_DELAY);
+
+  } else if (Homie.isConnected()) {
+    setProperty(cHomieNodeState).send(cHomieNodeState_Error);
+  }
+
+  return retval;
+}
+
+/**
+ * Parse a JSON object of fields, e.g. {"pool-max-temp": 28.5, "timer-start-h": 9}, into settings.
+ * All or nothing: settings are only changed if every field is valid.
+ */
+bool OperationModeNode::parseConfig(const char* json, ControlSettings& settings) {
+  StaticJsonDocument<CONFIG_DOCUMENT_SIZE> document;
+
+  const DeserializationError error = deserializeJson(document, json);
+  if (error) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ config: ") << error.c_str() << endl;
+    return false;
+  }
+
+  JsonObject fields = document.as<JsonObject>();
+  if (fields.isNull()) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ config: no JSON object") << endl;
+    return false;
+  }
+
+  ControlSettings candidate = settings;
+  for (JsonPair field : fields) {
+    // numbers as text, so temperatures take the same fixed-point path as single properties
+    char value[16];
+    if (field.value().is<const char*>()) {
+      strncpy(value, field.value().as<const char*>(), sizeof(value) - 1);
+      value[sizeof(value) - 1] = '\0';
     } else {
-      Homie.getLogger() << F("✖ OperationalMode: not connected.") << endl;
+      serializeJson(field.value(), value, sizeof(value));
+    }
+
+    if (!setField(candidate, field.key().c_str(), value)) {
+      Homie.getLogger() << FPSTR(cIndent) << F("✖ config rejected, nothing changed") << endl;
+      return false;
     }
+  }
 
-    _lastMeasurement = millis();
+  if (!timerValid(settings, candidate)) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ config rejected, nothing changed") << endl;
+    return false;
   }
+
+  Homie.getLogger() << FPSTR(cIndent) << F("✔ config: ") << fields.size() << F(" fields") << endl;
+  settings = candidate;
+  return true;
 }
 
 /**
- * Handle update by Homie message.
+ *
  */
-bool OperationModeNode::handleInput(const HomieRange& range, const String& property, const String& value) {
-  printCaption();
+size_t OperationModeNode::getPropertyCount() {
+  return properties.size();
+}
 
-  Homie.getLogger() << cIndent << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
-  bool retval;
+/**
+ *
+ */
+const PropertySpec& OperationModeNode::getProperty(const size_t i) {
+  return properties[i];
+}
 
-  if (property.equalsIgnoreCase(cMode)) {
-    Homie.getLogger() << cIndent << F("✔ set operational mode: ") << value << endl;
-    retval = this->setMode(value);
-
-  } else if (property.equalsIgnoreCase(cHysteresis)) {
-    Homie.getLogger() << cIndent << F("✔ hysteresis: ") << value << endl;
-    _hysteresis = value.toFloat();
-    retval      = true;
-
-  } else if (property.equalsIgnoreCase(cSolarMinTemp)) {
-    Homie.getLogger() << cIndent << F("✔ solar min temp: ") << value << endl;
-    _solarMinTemp = value.toFloat();
-    retval        = true;
-
-  } else if (property.equalsIgnoreCase(cPoolMaxTemp)) {
-    Homie.getLogger() << cIndent << F("✔ pool max temp: ") << value << endl;
-    _poolMaxTemp = value.toFloat();
-    retval       = true;
-
-  } else if (property.equalsIgnoreCase(cTimerStartHour)) {
-    Homie.getLogger() << cIndent << F("✔ Timer start hh: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerStartHour = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
+/**
+ * Parse one field into settings, including its range.
+ */
+bool OperationModeNode::setField(ControlSettings& settings, const char* field, const char* value) {
+  const PropertySpec* spec = properties.find(field);
 
-  } else if (property.equalsIgnoreCase(cTimerStartMin)) {
-    Homie.getLogger() << cIndent << F("✔  Timer start min.: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerStartMinutes = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
+  if (spec == nullptr) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ unknown field: ") << field << endl;
+    return false;
+  }
+  if (!spec->parseInto(&settings, value)) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ invalid value of ") << spec->id << F(" (") << spec->format << F("): ") << value
+                      << endl;
+    return false;
+  }
 
-  } else if (property.equalsIgnoreCase(cTimerEndHour)) {
-    Homie.getLogger() << cIndent << F("✔ Timer end h: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerEndHour = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
+  Homie.getLogger() << FPSTR(cIndent) << F("✔ ") << spec->id << F(": ") << value << endl;
+  return true;
+}
 
-  } else if (property.equalsIgnoreCase(cTimerEndMin)) {
-    Homie.getLogger() << cIndent << F("✔ Timer end min.: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerEndMinutes = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
+/**
+ * A change of the timer must keep its start before its end; updates which leave the timer as it was always pass.
+ */
+bool OperationModeNode::timerValid(const ControlSettings& previous, const ControlSettings& settings) {
+  if (settings.timerStartHour == previous.timerStartHour && settings.timerStartMinutes == previous.timerStartMinutes &&
+      settings.timerEndHour == previous.timerEndHour && settings.timerEndMinutes == previous.timerEndMinutes) {
+    return true;
+  }
+  if (settings.timerStartHour * 60 + settings.timerStartMinutes >= settings.timerEndHour * 60 + settings.timerEndMinutes) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ timer start not before end") << endl;
+    return false;
+  }
+  return true;
+}
 
-  } else {
-    retval = false;
+/**
+ * Publish the properties which changed since the last call, all of them after (re)connecting.
+ */
+void OperationModeNode::publishSettings() {
+  const ControlSettings settings = getSettings();
+
+  for (const PropertySpec& spec : properties) {
+    if (!_publishedValid || spec.differs(&settings, &_published)) {
+      char text[PROPERTY_TEXT_SIZE];
+      spec.printFrom(&settings, text);
+      setProperty(spec.id).send(text);
+    }
   }
 
-  //set 0 to force call of loop explicite on changes
-  _lastMeasurement = 0;
+  _published      = settings;
+  _publishedValid = true;
+}
 
-  return retval;
+/**
+ *
+ */
+void OperationModeNode::onReadyToOperate() {
+  _publishedValid = false;
 }
 
 /**
  *
  */
 void OperationModeNode::printCaption() {
-  Homie.getLogger() << cCaption << endl;
+  Homie.getLogger() << FPSTR(cCaption) << endl;
 }
@@ -6,92 +6,90 @@
 #pragma once
 
 #include <Homie.hpp>
-#include <Vector.h>
+#include <ArduinoJson.h>
 
 #include "DallasTemperatureNode.hpp"
 #include "Rule.hpp"
+#include "Temperature.hpp"
+#include "SettingsStore.hpp"
 #include "Timer.hpp"
 #include "TimeClientHelper.hpp"
+#include "DeadlineScheduler.hpp"
+#include "StaticVector.hpp"
+#include "NodeStrings.hpp"
+#include "PropertyRegistry.hpp"
 
 class OperationModeNode : public HomieNode {
 
 public:
+  static const uint8_t MAX_RULES = 8;
+
   OperationModeNode(const char* id, const char* name, const int measurementInterval = MEASUREMENT_INTERVAL);
-  ~OperationModeNode() {
-    // This could cause use after free - to bad it is designed that way
-    for (int i = 0; i < _ruleVec.Size(); i++)  // Delete ruleset on deletion of this object
-      delete _ruleVec[i];
-  }
 
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
   bool          setMode(String mode);
   String        getMode();
-  void          addRule(Rule* rule);
+  bool          addRule(Rule* rule);
   Rule*         getRule();
+  void          triggerEvaluation() { scheduler.trigger(_evaluationTask); }
+  unsigned long getFirstDecisionTime() const { return _firstDecision; }
 
   void setPoolTemperatureNode(DallasTemperatureNode* node) { _currentPoolTempNode = node; };
   void setSolarTemperatureNode(DallasTemperatureNode* node) { _currentSolarTempNode = node; };
 
-  void  setPoolMaxTemperature(float temp) { _poolMaxTemp = temp; };
-  float getPoolMaxTemperature() { return _poolMaxTemp; };
+  // in centi-degrees, see Temperature.hpp
+  void    setPoolMaxTemperature(int16_t temp);
+  int16_t getPoolMaxTemperature() { return _thresholds.poolMax; };
 
-  void  setSolarMinTemperature(float temp) { _solarMinTemp = temp; };
-  float getSolarMinTemperature() { return _solarMinTemp; };
+  void    setSolarMinTemperature(int16_t temp);
+  int16_t getSolarMinTemperature() { return _thresholds.solarMin; };
 
-  void  setTemperatureHysteresis(float temp) { _hysteresis = temp; };
-  float getTemperatureHysteresis() { return _hysteresis; };
+  void    setTemperatureHysteresis(int16_t temp);
+  int16_t getTemperatureHysteresis() { return _thresholds.hysteresis; };
 
   void         setTimerSetting(TimerSetting setting) { _timerSetting = setting; };
   TimerSetting getTimerSetting() { return _timerSetting; };
 
+  ControlSettings getSettings();
+  void            applySettings(const ControlSettings& settings);
+  bool            updateSettings(const char* property, const char* value);
+  bool            updateConfig(const char* json) { return updateSettings(cConfig, json); }
+  static bool     parseConfig(const char* json, ControlSettings& settings);
+
+  // the settable properties, see PropertyRegistry.hpp
+  static size_t              getPropertyCount();
+  static const PropertySpec& getProperty(const size_t i);
+
   enum MODE { AUTO, MANU, BOOST };
-  const char* STATUS_AUTO  = "auto";
-  const char* STATUS_MANU  = "manu";
-  const char* STATUS_BOOST = "boost";
-  const char* STATUS_TIMER = "timer";
+  static const char STATUS_AUTO[];
+  static const char STATUS_MANU[];
+  static const char STATUS_BOOST[];
+  static const char STATUS_TIMER[];
+  static const char STATUS_FILTER[];
+  static const char STATUS_PREDICT[];
 
 protected:
   void setup() override;
-  void loop() override;
+  void onReadyToOperate() override;
   bool handleInput(const HomieRange& range, const String& property, const String& value) override;
 
 private:
   // suggested rate is 1/60Hz (1m)
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
-  const char*      cCaption             = "• Operation Status:";
-  const char*      cIndent              = "  ◦ ";
-
-  const char* cMode     = "mode";
-  const char* cModeName = "Operation Mode";
-
-  const char* cPoolMaxTemp     = "pool-max-temp";
-  const char* cPoolMaxTempName = "Max. Pool Temperature";
+  static const char cCaption[];
 
-  const char* cSolarMinTemp     = "solar-min-temp";
-  const char* cSolarMinTempName = "Min. Solar Temperature";
+  static const char cConfig[];
+  static const char cConfigName[];
 
-  const char* cHysteresis     = "hysteresis";
-  const char* cHysteresisName = "Hysterese";
+  static const unsigned long COALESCE_DELAY       = 500;  // in ms
+  static const size_t        CONFIG_DOCUMENT_SIZE = 384;  // all fields with long values
 
-  const char* cTimerStartHour = "timer-start-h";
-  const char* cTimerStartMin  = "timer-start-min";
+  String                _mode = STATUS_AUTO;
+  TemperatureThresholds _thresholds;
 
-  const char* cTimerEndHour = "timer-end-h";
-  const char* cTimerEndMin  = "timer-end-min";
-
-  const char* cHomieNodeState     = "state";
-  const char* cHomieNodeStateName = "State";
-
-  const char* cHomieNodeState_OK    = "OK";
-  const char* cHomieNodeState_Error = "Error";
-
-  String        _mode = STATUS_AUTO;
-  float         _poolMaxTemp;
-  float         _solarMinTemp;
-  float         _hysteresis;
-  Vector<Rule*> _ruleVec;
+  StaticVector<Rule*, MAX_RULES> _rules;  // not owned
 
   DallasTemperatureNode* _currentPoolTempNode;
   DallasTemperatureNode* _currentSolarTempNode;
@@ -99,7 +97,21 @@ private:
   TimerSetting _timerSetting;
 
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
-
-  void printCaption();
+  int8_t        _evaluationTask;
+  unsigned long _firstDecision;  // millis() of the first rule evaluation, 0 until then
+
+  ControlSettings _published;  // as last published, see publishSettings()
+  bool            _publishedValid;
+#if LOOP_PROFILER
+  int8_t _inputProfile;
+  int8_t _ruleProfile;
+#endif
+
+  void        evaluate();
+  static void evaluateTask(void* node) { static_cast<OperationModeNode*>(node)->evaluate(); }
+  void        printCaption();
+  static bool setField(ControlSettings& settings, const char* field, const char* value);
+  static bool timerValid(const ControlSettings& previous, const ControlSettings& settings);
+  static bool isMode(const char* mode);
+  void        publishSettings();
 };
@@ -0,0 +1,133 @@
+/**
+ * Low-power idling of the main loop.
+ */
+#include "PowerManager.hpp"
+#include <Homie.hpp>
+#include "DeadlineScheduler.hpp"
+
+PowerManager powerManager;
+
+/**
+ *
+ */
+PowerManager::PowerManager() {
+  _mode        = POWER_OFF;
+  _suspended   = false;
+  _windowStart = 0;
+  _sleepTime   = 0;
+}
+
+/**
+ * @param mode  "off", "modem" or "light"
+ */
+bool PowerManager::setMode(const char* mode) {
+  PowerMode newMode;
+
+  if (strcmp(mode, "off") == 0) {
+    newMode = POWER_OFF;
+  } else if (strcmp(mode, "modem") == 0) {
+    newMode = POWER_MODEM;
+  } else if (strcmp(mode, "light") == 0) {
+    newMode = POWER_LIGHT;
+  } else {
+    Homie.getLogger() << F("✖ UNDEFINED power mode: ") << mode << endl;
+    return false;
+  }
+
+  _mode = newMode;
+  applyMode();
+  resetStatistics();
+
+  Homie.getLogger() << F("Power mode: ") << getModeName() << endl;
+  return true;
+}
+
+/**
+ *
+ */
+const char* PowerManager::getModeName() const {
+  switch (_mode) {
+    case POWER_MODEM:
+      return "modem";
+    case POWER_LIGHT:
+      return "light";
+    default:
+      return "off";
+  }
+}
+
+/**
+ *
+ */
+void PowerManager::applyMode() {
+#ifdef ESP32
+  WiFi.setSleep(_mode != POWER_OFF);
+#elif defined(ESP8266)
+  switch (_mode) {
+    case POWER_MODEM:
+      WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+      break;
+    case POWER_LIGHT:
+      WiFi.setSleepMode(WIFI_LIGHT_SLEEP);
+      break;
+    default:
+      WiFi.setSleepMode(WIFI_NONE_SLEEP);
+      break;
+  }
+#endif
+}
+
+/**
+ * Sleep until the next scheduler deadline. Call at the end of the main loop.
+ *
+ * Only sleeps while connected: connecting, configuration mode and OTA updates
+ * (see suspend()) run at full speed.
+ */
+void PowerManager::idle() {
+  if (_mode == POWER_OFF || _suspended || !Homie.isConnected()) {
+    return;
+  }
+
+  unsigned long sleep = scheduler.getIdleTime();
+  if (sleep < MIN_SLEEP) {
+    return;
+  }
+  if (sleep > MAX_SLEEP) {
+    sleep = MAX_SLEEP;
+  }
+
+  const unsigned long start = millis();
+  // the SDK puts modem/CPU to sleep while the main task waits
+  delay(sleep);
+  _sleepTime += millis() - start;
+}
+
+/**
+ * Share of time awake since the last reset.
+ */
+float PowerManager::getDutyCycle() const {
+  const unsigned long window = millis() - _windowStart;
+  if (window == 0 || _sleepTime >= window) {
+    return (_sleepTime > 0) ? 0.0 : 100.0;
+  }
+
+  return 100.0 * (window - _sleepTime) / window;
+}
+
+/**
+ *
+ */
+float PowerManager::getEstimatedCurrent() const {
+  const float    awake = getDutyCycle() / 100.0;
+  const uint16_t sleep = (_mode == POWER_LIGHT) ? CURRENT_LIGHT : CURRENT_MODEM;
+
+  return awake * CURRENT_ACTIVE + (1.0 - awake) * sleep;
+}
+
+/**
+ * Start a new measuring window.
+ */
+void PowerManager::resetStatistics() {
+  _windowStart = millis();
+  _sleepTime   = 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * Low-power idling of the main loop.
+ *
+ * Nothing is due for most of the time between two scheduler deadlines. With a
+ * power mode enabled, idle() sleeps until the next deadline (at most
+ * MAX_SLEEP, so Homie and the MQTT keep-alive are still served in time) and
+ * the WiFi modem is put to sleep between DTIM beacons:
+ *  - modem: CPU stays clocked, the radio sleeps,
+ *  - light: ESP8266 also suspends the CPU during the sleep, ESP32 falls back
+ *    to modem sleep (light sleep with WiFi needs a tickless idle build).
+ *
+ * The share of time awake (duty cycle) is measured per window; the current
+ * draw is estimated from it with typical values of the chip's datasheet,
+ * without the relays and other parts of the board.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class PowerManager {
+
+public:
+  enum PowerMode { POWER_OFF, POWER_MODEM, POWER_LIGHT };
+
+  PowerManager();
+
+  bool        setMode(const char* mode);
+  PowerMode   getMode() const { return _mode; }
+  const char* getModeName() const;
+
+  void idle();
+  void suspend(const bool suspended) { _suspended = suspended; }
+
+  float getDutyCycle() const;          // in %
+  float getEstimatedCurrent() const;   // in mA
+  void  resetStatistics();
+
+private:
+  static const unsigned long MAX_SLEEP = 1000;  // in ms
+  static const unsigned long MIN_SLEEP = 10;    // in ms, shorter idle times are not worth it
+
+#ifdef ESP32
+  static const uint16_t CURRENT_ACTIVE = 100;  // in mA, WiFi connected
+  static const uint16_t CURRENT_MODEM  = 30;
+  static const uint16_t CURRENT_LIGHT  = 30;  // no light sleep, see above
+#else
+  static const uint16_t CURRENT_ACTIVE = 70;
+  static const uint16_t CURRENT_MODEM  = 15;
+  static const uint16_t CURRENT_LIGHT  = 1;
+#endif
+
+  PowerMode     _mode;
+  bool          _suspended;
+  unsigned long _windowStart;  // millis()
+  unsigned long _sleepTime;    // in ms, within the window
+
+  void applyMode();
+};
+
+extern PowerManager powerManager;
@@ -0,0 +1,77 @@
+/**
+ * Parsers and printers of PropertySpec.
+ */
+#include "PropertyRegistry.hpp"
+
+/**
+ *
+ */
+bool parseEnumProperty(const PropertySpec& spec, const char* text, void* field) {
+  const size_t length = strlen(text);
+  if (length == 0 || length >= spec.size) {
+    return false;
+  }
+
+  for (const char* value = spec.format; *value != '\0';) {
+    const char*  separator   = strchr(value, ',');
+    const size_t valueLength = (separator != nullptr) ? (size_t)(separator - value) : strlen(value);
+
+    if (valueLength == length && strncmp(value, text, length) == 0) {
+      memset(field, 0, spec.size);
+      memcpy(field, text, length);
+      return true;
+    }
+    value += valueLength + ((separator != nullptr) ? 1 : 0);
+  }
+  return false;
+}
+
+/**
+ *
+ */
+size_t printEnumProperty(const PropertySpec& spec, const void* field, char* buffer) {
+  const size_t limit  = (spec.size < PROPERTY_TEXT_SIZE) ? spec.size : PROPERTY_TEXT_SIZE - 1;
+  const size_t length = strnlen(static_cast<const char*>(field), limit);
+  memcpy(buffer, field, length);
+  buffer[length] = '\0';
+  return length;
+}
+
+/**
+ *
+ */
+bool parseTemperatureProperty(const PropertySpec& spec, const char* text, void* field) {
+  int16_t value;
+  if (!parseCentiDegrees(text, value) || value < spec.min || value > spec.max) {
+    return false;
+  }
+  *static_cast<int16_t*>(field) = value;
+  return true;
+}
+
+/**
+ *
+ */
+size_t printTemperatureProperty(const PropertySpec&, const void* field, char* buffer) {
+  return formatCentiDegrees(*static_cast<const int16_t*>(field), buffer);
+}
+
+/**
+ *
+ */
+bool parseByteProperty(const PropertySpec& spec, const char* text, void* field) {
+  char*      end;
+  const long value = strtol(text, &end, 10);
+  if (end == text || *end != '\0' || value < spec.min || value > spec.max) {
+    return false;
+  }
+  *static_cast<uint8_t*>(field) = value;
+  return true;
+}
+
+/**
+ *
+ */
+size_t printByteProperty(const PropertySpec&, const void* field, char* buffer) {
+  return snprintf(buffer, PROPERTY_TEXT_SIZE, "%u", *static_cast<const uint8_t*>(field));
+}
@@ -0,0 +1,171 @@
+/**
+ * Compile-time table of settable Homie properties.
+ *
+ * Each entry describes one field of a settings struct: Homie id, name,
+ * datatype, format and unit, where the field is stored and how it is parsed
+ * and printed. The range in the Homie format ("0:40") is also the range the
+ * parser accepts, so advertising and validation cannot disagree.
+ *
+ * PropertyRegistry hashes the ids into a bucket table at compile time; input
+ * is dispatched with one hash and one string compare.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "IndexSequence.hpp"
+#include "Temperature.hpp"
+
+static const size_t PROPERTY_TEXT_SIZE = 16;  // printed value including '\0'
+
+struct PropertySpec;
+
+typedef bool (*PropertyParser)(const PropertySpec& spec, const char* text, void* field);
+typedef size_t (*PropertyPrinter)(const PropertySpec& spec, const void* field, char* buffer);
+
+bool   parseEnumProperty(const PropertySpec& spec, const char* text, void* field);
+size_t printEnumProperty(const PropertySpec& spec, const void* field, char* buffer);
+bool   parseTemperatureProperty(const PropertySpec& spec, const char* text, void* field);
+size_t printTemperatureProperty(const PropertySpec& spec, const void* field, char* buffer);
+bool   parseByteProperty(const PropertySpec& spec, const char* text, void* field);
+size_t printByteProperty(const PropertySpec& spec, const void* field, char* buffer);
+
+/**
+ *
+ */
+struct PropertySpec {
+  const char*     id;
+  const char*     name;
+  const char*     datatype;  // Homie datatype
+  const char*     format;    // Homie format: "min:max" or the enum values
+  const char*     unit;      // nullptr if none
+  uint8_t         offset;    // of the field in the settings struct
+  uint8_t         size;
+  int16_t         min;       // range of the field, from format
+  int16_t         max;
+  PropertyParser  parse;     // false if invalid or out of range, field unchanged then
+  PropertyPrinter print;     // buffer of PROPERTY_TEXT_SIZE
+
+  bool parseInto(void* settings, const char* text) const {
+    return parse(*this, text, static_cast<uint8_t*>(settings) + offset);
+  }
+  size_t printFrom(const void* settings, char* buffer) const {
+    return print(*this, static_cast<const uint8_t*>(settings) + offset, buffer);
+  }
+  bool isText() const { return print == printEnumProperty; }  // quoted in JSON
+  bool differs(const void* settings, const void* other) const {
+    return memcmp(static_cast<const uint8_t*>(settings) + offset, static_cast<const uint8_t*>(other) + offset, size) != 0;
+  }
+};
+
+/**
+ * Leading decimal number of text; ranges are not negative.
+ */
+constexpr int16_t formatNumber(const char* text, const int16_t value = 0) {
+  return (*text >= '0' && *text <= '9') ? formatNumber(text + 1, value * 10 + (*text - '0')) : value;
+}
+
+constexpr const char* formatRangeEnd(const char* format) {
+  return (*format == '\0') ? format : (*format == ':') ? format + 1 : formatRangeEnd(format + 1);
+}
+
+/**
+ * Field char[size] holding one of the comma separated values of format.
+ */
+constexpr PropertySpec enumProperty(const char* id, const char* name, const char* format, const size_t offset,
+                                    const size_t size) {
+  return PropertySpec{
+      id, name, "enum", format, nullptr, (uint8_t)offset, (uint8_t)size, 0, 0, parseEnumProperty, printEnumProperty};
+}
+
+/**
+ * Field int16_t in centi-degrees, format in degrees.
+ */
+constexpr PropertySpec temperatureProperty(const char* id, const char* name, const char* format, const char* unit,
+                                           const size_t offset) {
+  return PropertySpec{id,
+                      name,
+                      "float",
+                      format,
+                      unit,
+                      (uint8_t)offset,
+                      sizeof(int16_t),
+                      centiFromDegrees(formatNumber(format)),
+                      centiFromDegrees(formatNumber(formatRangeEnd(format))),
+                      parseTemperatureProperty,
+                      printTemperatureProperty};
+}
+
+/**
+ * Field uint8_t; advertised as float like the timer properties always were.
+ */
+constexpr PropertySpec byteProperty(const char* id, const char* name, const char* format, const char* unit, const size_t offset) {
+  return PropertySpec{id,
+                      name,
+                      "float",
+                      format,
+                      unit,
+                      (uint8_t)offset,
+                      sizeof(uint8_t),
+                      formatNumber(format),
+                      formatNumber(formatRangeEnd(format)),
+                      parseByteProperty,
+                      printByteProperty};
+}
+
+constexpr char toLowerAscii(const char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/**
+ * FNV-1a of the lower case id.
+ */
+constexpr uint32_t propertyHash(const char* id, const uint32_t hash = 2166136261UL) {
+  return (*id == '\0') ? hash : propertyHash(id + 1, (uint32_t)((hash ^ (uint8_t)toLowerAscii(*id)) * 16777619UL));
+}
+
+/**
+ * Hashed lookup of a table of N properties. Every id needs a bucket of its
+ * own, checked with bucketsUnique() in a static_assert; try another number of
+ * buckets if it fails.
+ */
+template <size_t N, size_t BUCKETS>
+class PropertyRegistry {
+
+public:
+  constexpr PropertyRegistry(const PropertySpec (&specs)[N])
+      : PropertyRegistry(typename MakeIndexSequence<BUCKETS>::type(), specs) {}
+
+  const PropertySpec& operator[](const size_t i) const { return _specs[i]; }
+  size_t              size() const { return N; }
+  const PropertySpec* begin() const { return _specs; }
+  const PropertySpec* end() const { return _specs + N; }
+
+  /**
+   * Property with the id (case insensitive), nullptr if there is none.
+   */
+  const PropertySpec* find(const char* id) const {
+    const int8_t i = _buckets[propertyHash(id) % BUCKETS];
+    return (i >= 0 && strcasecmp(_specs[i].id, id) == 0) ? &_specs[i] : nullptr;
+  }
+
+  static constexpr bool bucketsUnique(const PropertySpec (&specs)[N], const size_t i = 0) {
+    return (i >= N) ? true : (bucketCount(specs, propertyHash(specs[i].id) % BUCKETS) == 1) && bucketsUnique(specs, i + 1);
+  }
+
+private:
+  template <size_t... B>
+  constexpr PropertyRegistry(IndexSequence<B...>, const PropertySpec (&specs)[N])
+      : _specs(specs), _buckets{bucketEntry(specs, B)...} {}
+
+  static constexpr int8_t bucketEntry(const PropertySpec (&specs)[N], const size_t bucket, const size_t i = 0) {
+    return (i >= N) ? -1 : (propertyHash(specs[i].id) % BUCKETS == bucket) ? (int8_t)i : bucketEntry(specs, bucket, i + 1);
+  }
+
+  static constexpr uint8_t bucketCount(const PropertySpec (&specs)[N], const size_t bucket, const size_t i = 0) {
+    return (i >= N) ? 0 : (propertyHash(specs[i].id) % BUCKETS == bucket) + bucketCount(specs, bucket, i + 1);
+  }
+
+  const PropertySpec* _specs;
+  int8_t              _buckets[BUCKETS];
+};
@@ -5,53 +5,273 @@
  * https://github.com/YuriiSalimov/RelayModule
  */
 #include "RelayModuleNode.hpp"
+#include "Timer.hpp"
+
+const char RelayModuleNode::cCaption[] PROGMEM = "• Relay Module:";
+
+const char RelayModuleNode::cSwitch[]           = "switch";
+const char RelayModuleNode::cSwitchName[]       = "Switch";
+const char RelayModuleNode::cTransition[]       = "transition";
+const char RelayModuleNode::cTransitionName[]   = "Last Transition";
+const char RelayModuleNode::cRuntimeTotal[]     = "runtime-total";
+const char RelayModuleNode::cRuntimeTotalName[] = "Total Runtime";
+const char RelayModuleNode::cRuntimeToday[]     = "runtime-today";
+const char RelayModuleNode::cRuntimeTodayName[] = "Runtime Today";
+const char RelayModuleNode::cCycles[]           = "cycles";
+const char RelayModuleNode::cCyclesName[]       = "Switch Cycles";
+const char RelayModuleNode::cEnergy[]           = "energy";
+const char RelayModuleNode::cEnergyName[]       = "Estimated Energy";
 
 RelayModuleNode::RelayModuleNode(const char* id, const char* name, const uint8_t pin, const int measurementInterval)
     : HomieNode(id, name, "switch") {
   _pin                 = pin;
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = 0;
+  _statusTask          = DeadlineScheduler::INVALID_TASK;
+#if LOOP_PROFILER
+  _inputProfile = LoopProfiler::INVALID_SLOT;
+#endif
+  _stateSlot           = -1;
+  _requestedState      = false;
+  _pending             = false;
+  _hasSwitched         = false;
+  _lastTransition      = 0;
+  _minOnTime           = 0;
+  _minOffTime          = 0;
+  _power               = 0;
+  _lastAccounting      = 0;
+  _onTimeRemainder     = 0;
+  _energyRemainder     = 0;
+  memset(&_statistics, 0, sizeof(_statistics));
 }
 
 /**
  *
  */
-void RelayModuleNode::setSwitch(const boolean state) {
+void RelayModuleNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.setInterval(_statusTask, _measurementInterval * 1000UL);
+}
+
+/**
+ * Request a new switch state.
+ *
+ * Requesting the current state is a no-op: the relay driver is not touched and nothing is published.
+ * Otherwise the request is handed to the RelaySequencer, which switches right away if nothing blocks
+ * the transition, or later once the minimum on/off time, the stagger delay and the dependencies allow it.
+ * With queueIfBlocked == false a request blocked by the minimum on/off time is denied instead.
+ * A later request for the current state cancels a queued one.
+ */
+RelayModuleNode::SwitchResult RelayModuleNode::setSwitch(const boolean state, const boolean queueIfBlocked) {
+  const boolean isOn = getSwitch();
+
+  if (state == isOn) {
+    if (_pending) {
+      Homie.getLogger() << FPSTR(cIndent) << F("Relay ") << getId() << F(": queued transition cancelled") << endl;
+      _pending        = false;
+      _requestedState = state;
+    }
+    return UNCHANGED;
+  }
+
+  if (_pending && state == _requestedState) {
+    return QUEUED;
+  }
+
+  const unsigned long remaining = remainingBlockTime();
+  if (remaining > 0 && !queueIfBlocked) {
+    Homie.getLogger() << FPSTR(cIndent) << F("Relay ") << getId() << F(": switch ") << (state ? cFlagOn : cFlagOff)
+                      << F(" denied, blocked for ") << remaining << F(" s") << endl;
+    publishTransition(DENIED);
+    return DENIED;
+  }
+
+  if (!relaySequencer.mayEverSwitch(this, state)) {
+    Homie.getLogger() << FPSTR(cIndent) << F("Relay ") << getId() << F(": switch ") << (state ? cFlagOn : cFlagOff)
+                      << F(" denied by dependency") << endl;
+    publishTransition(DENIED);
+    return DENIED;
+  }
+
+  request(state);
+  relaySequencer.loop();
+
+  if (!_pending) {
+    return SWITCHED;
+  }
+
+  Homie.getLogger() << FPSTR(cIndent) << F("Relay ") << getId() << F(": switch ") << (state ? cFlagOn : cFlagOff) << F(" queued")
+                    << endl;
+  publishTransition(QUEUED);
+  return QUEUED;
+}
+
+/**
+ * Mark a transition as pending, the RelaySequencer executes it.
+ */
+void RelayModuleNode::request(const boolean state) {
+  _requestedState = state;
+  _pending        = (state != getSwitch());
+}
+
+/**
+ *
+ */
+void RelayModuleNode::completeTransition() {
+  _pending = false;
+  actuate(_requestedState);
+  publishTransition(SWITCHED);
+}
+
+/**
+ *
+ */
+void RelayModuleNode::cancelTransition(const SwitchResult reason) {
+  Homie.getLogger() << FPSTR(cIndent) << F("Relay ") << getId() << F(": queued transition dropped") << endl;
+  _pending        = false;
+  _requestedState = getSwitch();
+  publishTransition(reason);
+}
+
+/**
+ *
+ */
+boolean RelayModuleNode::getSwitch() {
+  return relay->isOn();
+}
+
+/**
+ * Drive the relay and publish/persist the new state.
+ */
+void RelayModuleNode::actuate(const boolean state) {
+  // close the running interval before the state changes
+  updateStatistics(false);
 
   if (state) {
+    _statistics.cycles++;
     relay->on();
   } else {
     relay->off();
   }
+  _lastTransition = millis();
+  _hasSwitched    = true;
 
-  if(Homie.isConnected()){
+  if (Homie.isConnected()) {
     setProperty(cSwitch).send((state ? cFlagOn : cFlagOff));
     setProperty(cHomieNodeState).send(cHomieNodeState_OK);
   }
-  // persist value
-#ifdef ESP32
-  preferences.begin(getId(), false);
-  preferences.putBool(cSwitch, state);
-  preferences.end();
-#elif defined(ESP8266)
+  // persist value, written to flash only on a real change
+  relayStateStore.setState(_stateSlot, state);
+  relayStateStore.setStatistics(_stateSlot, _statistics, true);
 
-#endif
+  Homie.getLogger() << FPSTR(cIndent) << F("Relay is ") << (state ? cFlagOn : cFlagOff) << endl;
+}
+
+/**
+ * Seconds until the relay may leave its current state.
+ */
+unsigned long RelayModuleNode::remainingBlockTime() {
+  if (!_hasSwitched) {
+    return 0;
+  }
+
+  const unsigned long minTime = (getSwitch() ? _minOnTime : _minOffTime) * 1000UL;
+  const unsigned long elapsed = millis() - _lastTransition;
 
-  Homie.getLogger() << cIndent << F("Relay is ") << (state ? cFlagOn : cFlagOff) << endl;
+  return (elapsed >= minTime) ? 0 : (minTime - elapsed + 999UL) / 1000UL;
 }
 
 /**
  *
  */
-boolean RelayModuleNode::getSwitch() {
-  return relay->isOn();
+void RelayModuleNode::publishTransition(const SwitchResult result) {
+  if (!Homie.isConnected()) {
+    return;
+  }
+
+  switch (result) {
+    case SWITCHED:
+      setProperty(cTransition).send(F("switched"));
+      break;
+    case QUEUED:
+      setProperty(cTransition).send(F("queued"));
+      break;
+    case DENIED:
+      setProperty(cTransition).send(F("denied"));
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * Add the time since the last call to the counters while the relay is on.
+ */
+void RelayModuleNode::updateStatistics(const boolean urgent) {
+  const unsigned long now     = millis();
+  uint32_t            seconds = 0;
+
+  if (getSwitch()) {
+    _onTimeRemainder += now - _lastAccounting;
+    seconds = _onTimeRemainder / 1000UL;
+    _onTimeRemainder %= 1000UL;
+
+    _statistics.onTimeTotal += seconds;
+    _statistics.onTimeToday += seconds;
+
+    _energyRemainder += seconds * _power;
+    _statistics.energy += _energyRemainder / 3600UL;
+    _energyRemainder %= 3600UL;
+  }
+  _lastAccounting = now;
+
+  if (seconds > 0 || urgent) {
+    relayStateStore.setStatistics(_stateSlot, _statistics, urgent);
+  }
+}
+
+/**
+ * Counters including the running on-time.
+ */
+const RelayStatistics& RelayModuleNode::getStatistics() {
+  updateStatistics(false);
+  return _statistics;
+}
+
+/**
+ * Restart the daily counter at local midnight.
+ */
+void RelayModuleNode::checkDayRollover() {
+  const uint16_t today = getCurrentDay();
+  if (today == 0 || today == _statistics.day) {
+    return;
+  }
+
+  updateStatistics(false);
+  if (_statistics.day != 0) {
+    // a new day, not just the first time sync ever
+    Homie.getLogger() << FPSTR(cIndent) << F("Relay ") << getId() << F(": runtime yesterday ") << _statistics.onTimeToday
+                      << F(" s") << endl;
+    _statistics.onTimeToday = 0;
+  }
+  _statistics.day = today;
+  updateStatistics(true);
+}
+
+/**
+ *
+ */
+void RelayModuleNode::publishStatistics() {
+  setProperty(cRuntimeTotal).send(String(_statistics.onTimeTotal / 3600.0, 2));
+  setProperty(cRuntimeToday).send(String(_statistics.onTimeToday / 3600.0, 2));
+  setProperty(cCycles).send(String(_statistics.cycles));
+  setProperty(cEnergy).send(String(_statistics.energy / 1000.0, 3));
 }
 
 /**
  *
  */
 void RelayModuleNode::printCaption() {
-  Homie.getLogger() << cCaption << F(" pin[") << _pin << F("]:") << endl;
+  Homie.getLogger() << FPSTR(cCaption) << F(" pin[") << _pin << F("]:") << endl;
 }
 
 /**
@@ -59,9 +279,10 @@ void RelayModuleNode::printCaption() {
  *
  */
 bool RelayModuleNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+  PROFILE_SCOPE(_inputProfile);
   printCaption();
 
-  Homie.getLogger() << cIndent << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
   bool retval;
 
   if (value != cFlagOn && value != cFlagOff) {
@@ -73,9 +294,8 @@ bool RelayModuleNode::handleInput(const HomieRange& range, const String& propert
     retval = false;
   } else {
     const bool flag = (value == cFlagOn);
-    setSwitch(flag);
-
-    retval = true;
+    // manual commands get an immediate answer instead of firing later
+    retval = (setSwitch(flag, false) != DENIED);
   }
 
   Homie.getLogger() << F("〽 handleInput <-") << retval << endl;
@@ -83,23 +303,41 @@ bool RelayModuleNode::handleInput(const HomieRange& range, const String& propert
 }
 
 /**
- *
+ * Periodic status: account the runtime, check for a new day and publish.
  */
-void RelayModuleNode::loop() {
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-
-    if (Homie.isConnected()) {
+void RelayModuleNode::publishStatus() {
+  updateStatistics(false);
+  checkDayRollover();
 
-      const boolean isOn = getSwitch();
-      Homie.getLogger() << F("〽 Sending Switch status: ") << getId() << F("switch: ") << (isOn ? cFlagOn : cFlagOff) << endl;
+  if (Homie.isConnected()) {
+    const boolean isOn = getSwitch();
+    Homie.getLogger() << F("〽 Sending Switch status: ") << getId() << F("switch: ") << (isOn ? cFlagOn : cFlagOff) << endl;
 
-      if(Homie.isConnected()) {
-        setProperty(cSwitch).send((isOn ? cFlagOn : cFlagOff));
-      }
-    }
+    setProperty(cSwitch).send((isOn ? cFlagOn : cFlagOff));
+    publishStatistics();
+  }
+}
 
-    _lastMeasurement = millis();
+/**
+ * Drive the relay to its persisted state. Called by setup(), or earlier during boot to restore the relays
+ * before the configuration is loaded and the network is up.
+ */
+void RelayModuleNode::begin() {
+  if (relay != NULL) {
+    return;
   }
+
+  relay = new RelayModule(_pin);
+
+  boolean storedSwitchValue;
+  _stateSlot      = relayStateStore.attach(getId(), &storedSwitchValue, &_statistics);
+  _lastAccounting = millis();
+  relaySequencer.attach(this);
+
+  //restore persisted state, starts are staggered by the sequencer
+  relay->off();
+  _lastTransition = millis();
+  request(storedSwitchValue);
 }
 
 /**
@@ -109,23 +347,17 @@ void RelayModuleNode::setup() {
   printCaption();
 
   advertise(cSwitch).setName(cSwitchName).setDatatype("boolean").settable();
+  advertise(cTransition).setName(cTransitionName).setDatatype("enum").setFormat("switched,queued,denied");
+  advertise(cRuntimeTotal).setName(cRuntimeTotalName).setDatatype("float").setUnit("h");
+  advertise(cRuntimeToday).setName(cRuntimeTodayName).setDatatype("float").setUnit("h");
+  advertise(cCycles).setName(cCyclesName).setDatatype("integer");
+  advertise(cEnergy).setName(cEnergyName).setDatatype("float").setUnit("kWh");
   advertise(cHomieNodeState).setName(cHomieNodeStateName).setDatatype("string");
 
-  relay = new RelayModule(_pin);
+  begin();
 
-#ifdef ESP32
-  preferences.begin(getId(), false);
-  boolean storedSwitchValue = preferences.getBool(cSwitch, false);
-  // Close the Preferences
-  preferences.end();
-#elif defined(ESP8266)
-  boolean storedSwitchValue = false;
+  _statusTask = scheduler.addPeriodic(getId(), publishStatusTask, this, _measurementInterval * 1000UL);
+#if LOOP_PROFILER
+  _inputProfile = loopProfiler.addSlot(getId(), "input");
 #endif
-
-  //restore from preferences
-  if (storedSwitchValue) {
-    relay->on();
-  } else {
-    relay->off();
-  }
 }
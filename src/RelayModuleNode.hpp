@@ -7,61 +7,108 @@
 
 #include <Homie.hpp>
 #include <RelayModule.h>
-#ifdef ESP32
-#include <Preferences.h>
-#elif defined(ESP8266)
-
-#endif
+#include "RelayStateStore.hpp"
+#include "RelaySequencer.hpp"
+#include "DeadlineScheduler.hpp"
+#include "NodeStrings.hpp"
 
 class RelayModuleNode : public HomieNode {
 
 public:
+  /**
+   * Outcome of a switch request.
+   */
+  enum SwitchResult {
+    UNCHANGED,  // relay already is (or stays) in the requested state
+    SWITCHED,   // relay has been switched
+    QUEUED,     // waiting for the minimum on/off time, the stagger delay or a dependency
+    DENIED      // blocked by the minimum on/off time or a dependency, request dropped
+  };
+
   RelayModuleNode(const char* id, const char* name, const uint8_t pin, const int measurementInterval = MEASUREMENT_INTERVAL);
 
   ~RelayModuleNode() { delete relay; }
 
+  void          begin();
   uint8_t       getPin() const { return _pin; }
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
-  void          setSwitch(const boolean state);
-  boolean       getSwitch();
+  void          setMinOnTime(unsigned long seconds) { _minOnTime = seconds; }
+  unsigned long getMinOnTime() const { return _minOnTime; }
+  void          setMinOffTime(unsigned long seconds) { _minOffTime = seconds; }
+  unsigned long getMinOffTime() const { return _minOffTime; }
+  void          setPower(unsigned long watts) { _power = watts; }
+  unsigned long getPower() const { return _power; }
+
+  const RelayStatistics& getStatistics();
+
+  SwitchResult setSwitch(const boolean state, const boolean queueIfBlocked = true);
+  boolean      getSwitch();
+  boolean      isPending() const { return _pending; }
+  boolean      getRequestedSwitch() const { return _requestedState; }
 
 protected:
   virtual void setup() override;
   virtual bool handleInput(const HomieRange& range, const String& property, const String& value);
 
-  virtual void loop() override;
-
 private:
   // suggested rate is 1/60Hz (1m)
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
 
-  const char* cCaption = "• Relay Module:";
-  const char* cIndent  = "  ◦ ";
+  static const char cCaption[];
 
-  const char* cSwitch     = "switch";
-  const char* cSwitchName = "Switch";
+  static const char cSwitch[];
+  static const char cSwitchName[];
 
-  const char* cFlagOn  = "true";
-  const char* cFlagOff = "false";
+  static const char cTransition[];
+  static const char cTransitionName[];
 
-  const char* cHomieNodeState     = "state";
-  const char* cHomieNodeStateName = "State";
-
-  const char* cHomieNodeState_OK    = "OK";
-  const char* cHomieNodeState_Error = "Error";
+  static const char cRuntimeTotal[];
+  static const char cRuntimeTotalName[];
+  static const char cRuntimeToday[];
+  static const char cRuntimeTodayName[];
+  static const char cCycles[];
+  static const char cCyclesName[];
+  static const char cEnergy[];
+  static const char cEnergyName[];
 
   uint8_t       _pin;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
-  RelayModule*  relay = NULL;
-
-#ifdef ESP32
-  Preferences preferences;
-#elif defined(ESP8266)
-
+  int8_t        _statusTask;
+#if LOOP_PROFILER
+  int8_t _inputProfile;
 #endif
-
-  void printCaption();
+  RelayModule*  relay = NULL;
+  int8_t        _stateSlot;
+
+  boolean       _requestedState;
+  boolean       _pending;
+  boolean       _hasSwitched;
+  unsigned long _lastTransition;  // millis() of the last switch
+  unsigned long _minOnTime;       // in seconds
+  unsigned long _minOffTime;      // in seconds
+
+  RelayStatistics _statistics;
+  unsigned long   _power;            // in W
+  unsigned long   _lastAccounting;   // millis() the counters were last updated
+  unsigned long   _onTimeRemainder;  // in ms, not yet added to the counters
+  unsigned long   _energyRemainder;  // in Ws, not yet added to the counters
+
+  void          actuate(const boolean state);
+  void          publishTransition(const SwitchResult result);
+  void          updateStatistics(const boolean urgent);
+  void          checkDayRollover();
+  void          publishStatistics();
+  void          publishStatus();
+  static void   publishStatusTask(void* node) { static_cast<RelayModuleNode*>(node)->publishStatus(); }
+  void          printCaption();
+
+  // used by RelaySequencer
+  friend class RelaySequencer;
+  void          request(const boolean state);
+  void          completeTransition();
+  void          cancelTransition(const SwitchResult reason);
+  unsigned long remainingBlockTime();
+  unsigned long getStateDuration() const { return millis() - _lastTransition; }
 };
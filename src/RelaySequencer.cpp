@@ -0,0 +1,152 @@
+/**
+ * Shared command queue of all relays.
+ */
+#include "RelaySequencer.hpp"
+#include "RelayModuleNode.hpp"
+
+RelaySequencer relaySequencer;
+
+/**
+ *
+ */
+RelaySequencer::RelaySequencer() {
+  _count        = 0;
+  _staggerDelay = 0;
+  _lastStart    = 0;
+  _started      = false;
+}
+
+/**
+ * Register a relay. Relays start in the order they were attached.
+ */
+void RelaySequencer::attach(RelayModuleNode* relay) {
+  if (indexOf(relay) >= 0 || _count >= MAX_RELAYS) {
+    return;
+  }
+  _entries[_count].relay           = relay;
+  _entries[_count].master          = -1;
+  _entries[_count].dependencyDelay = 0;
+  _count++;
+}
+
+/**
+ * The dependent relay may only run while master runs: it starts after master has been on
+ * for delaySeconds and is stopped before master stops.
+ */
+void RelaySequencer::setDependency(RelayModuleNode* dependent, RelayModuleNode* master, const unsigned long delaySeconds) {
+  attach(master);
+  attach(dependent);
+
+  const int8_t index = indexOf(dependent);
+  if (index >= 0) {
+    _entries[index].master          = indexOf(master);
+    _entries[index].dependencyDelay = delaySeconds * 1000UL;
+  }
+}
+
+/**
+ * False if the requested state can never be reached in the current situation,
+ * i.e. a dependent relay should start while its master is neither running nor about to start.
+ */
+bool RelaySequencer::mayEverSwitch(RelayModuleNode* relay, const boolean state) {
+  const int8_t index = indexOf(relay);
+  if (!state || index < 0 || _entries[index].master < 0) {
+    return true;
+  }
+
+  RelayModuleNode* master = _entries[_entries[index].master].relay;
+  return master->getSwitch() || (master->isPending() && master->getRequestedSwitch());
+}
+
+/**
+ * Execute due transitions. Never blocks; call it on every pass of the main loop.
+ */
+void RelaySequencer::loop() {
+  // stops first, repeated so that a master can follow its dependents in the same pass
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (uint8_t i = 0; i < _count; i++) {
+      RelayModuleNode* relay = _entries[i].relay;
+      if (relay->isPending() && !relay->getRequestedSwitch() && relay->remainingBlockTime() == 0 && dependentsOff(i)) {
+        relay->completeTransition();
+        progress = true;
+      }
+    }
+  }
+
+  // then at most one start per stagger delay
+  if (_started && millis() - _lastStart < _staggerDelay) {
+    return;
+  }
+
+  for (uint8_t i = 0; i < _count; i++) {
+    RelayModuleNode* relay = _entries[i].relay;
+    if (!relay->isPending() || !relay->getRequestedSwitch()) {
+      continue;
+    }
+
+    if (!mayEverSwitch(relay, true)) {
+      // master has been stopped meanwhile
+      relay->cancelTransition(RelayModuleNode::DENIED);
+      continue;
+    }
+
+    if (relay->remainingBlockTime() == 0 && masterReady(i)) {
+      relay->completeTransition();
+      _lastStart = millis();
+      _started   = true;
+      return;
+    }
+  }
+}
+
+/**
+ *
+ */
+int8_t RelaySequencer::indexOf(RelayModuleNode* relay) const {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_entries[i].relay == relay) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * True if no relay depending on the given one is running.
+ * Running dependents are asked to stop.
+ */
+bool RelaySequencer::dependentsOff(const uint8_t index) {
+  bool retval = true;
+
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_entries[i].master != index) {
+      continue;
+    }
+
+    RelayModuleNode* dependent = _entries[i].relay;
+    if (dependent->getSwitch()) {
+      dependent->request(false);
+      retval = false;
+    } else if (dependent->isPending()) {
+      // a start of the dependent would violate the dependency
+      dependent->cancelTransition(RelayModuleNode::DENIED);
+    }
+  }
+
+  return retval;
+}
+
+/**
+ * True if the relay the given one depends on has been running long enough.
+ */
+bool RelaySequencer::masterReady(const uint8_t index) {
+  const int8_t master = _entries[index].master;
+  if (master < 0) {
+    return true;
+  }
+
+  RelayModuleNode* relay = _entries[master].relay;
+  return relay->getSwitch() && !relay->isPending() && relay->getStateDuration() >= _entries[index].dependencyDelay;
+}
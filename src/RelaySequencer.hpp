@@ -0,0 +1,51 @@
+/**
+ * Shared command queue of all relays.
+ *
+ * Switch requests of RelayModuleNodes are executed here, without blocking:
+ *  - stops run first, dependents before the relay they depend on,
+ *  - starts run one at a time, separated by the stagger delay, to avoid the
+ *    inrush current of two pump motors starting together,
+ *  - a dependent relay (the solar pump) only starts after the relay it depends
+ *    on (the pool pump) has been running for the dependency delay.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class RelayModuleNode;
+
+class RelaySequencer {
+
+public:
+  static const uint8_t MAX_RELAYS = 8;
+
+  RelaySequencer();
+
+  void          attach(RelayModuleNode* relay);
+  void          setDependency(RelayModuleNode* dependent, RelayModuleNode* master, const unsigned long delaySeconds);
+  void          setStaggerDelay(const unsigned long seconds) { _staggerDelay = seconds * 1000UL; }
+  unsigned long getStaggerDelay() const { return _staggerDelay / 1000UL; }
+
+  bool mayEverSwitch(RelayModuleNode* relay, const boolean state);
+  void loop();
+
+private:
+  struct Entry {
+    RelayModuleNode* relay;
+    int8_t           master;           // index of the relay this one depends on, -1 if none
+    unsigned long    dependencyDelay;  // in ms
+  };
+
+  Entry         _entries[MAX_RELAYS];
+  uint8_t       _count;
+  unsigned long _staggerDelay;  // in ms
+  unsigned long _lastStart;
+  bool          _started;
+
+  int8_t indexOf(RelayModuleNode* relay) const;
+  bool   dependentsOff(const uint8_t index);
+  bool   masterReady(const uint8_t index);
+};
+
+extern RelaySequencer relaySequencer;
@@ -0,0 +1,194 @@
+/**
+ * Persistent switch states and statistics of all relays.
+ */
+#include "RelayStateStore.hpp"
+#include <Homie.hpp>
+#ifdef ESP32
+#include <Preferences.h>
+#endif
+
+RelayStateStore relayStateStore;
+
+/**
+ *
+ */
+RelayStateStore::RelayStateStore() {
+  memset(&_record, 0, sizeof(_record));
+  memset(&_statsRecord, 0, sizeof(_statsRecord));
+  _loaded          = false;
+  _dirty           = false;
+  _lastChange      = 0;
+  _statsDirty      = false;
+  _statsUrgent     = false;
+  _lastStatsChange = 0;
+  _lastStatsWrite  = 0;
+}
+
+/**
+ * Register a relay and return its slot, or -1 if all slots are taken.
+ * storedState and storedStatistics receive the persisted values (false/zero if unknown).
+ */
+int8_t RelayStateStore::attach(const char* id, boolean* storedState, RelayStatistics* storedStatistics) {
+  load();
+
+  const uint16_t hash = hashId(id);
+  int8_t         slot = -1;
+
+  for (uint8_t i = 0; i < MAX_RELAYS; i++) {
+    if (_record.idHash[i] == hash) {
+      slot = i;
+      break;
+    }
+  }
+
+  if (slot >= 0) {
+    *storedState      = (_record.states & (1 << slot)) != 0;
+    *storedStatistics = _statsRecord.statistics[slot];
+
+  } else {
+    // unknown relay: take the first free slot
+    for (uint8_t i = 0; i < MAX_RELAYS && slot < 0; i++) {
+      if (_record.idHash[i] == 0) {
+        slot = i;
+      }
+    }
+    if (slot < 0) {
+      Homie.getLogger() << FPSTR(cIndent) << F("✖ RelayStateStore: no free slot for ") << id << endl;
+      *storedState = false;
+      memset(storedStatistics, 0, sizeof(RelayStatistics));
+      return -1;
+    }
+    _record.idHash[slot] = hash;
+    memset(&_statsRecord.statistics[slot], 0, sizeof(RelayStatistics));
+    *storedStatistics = _statsRecord.statistics[slot];
+
+#ifdef ESP32
+    // migrate the state written by older firmware
+    Preferences preferences;
+    preferences.begin(id, true);
+    *storedState = preferences.getBool("switch", false);
+    preferences.end();
+#elif defined(ESP8266)
+    *storedState = false;
+#endif
+    setState(slot, *storedState);
+  }
+
+  return slot;
+}
+
+/**
+ * Remember the state of a slot. Only a real change marks the store dirty.
+ */
+void RelayStateStore::setState(const int8_t slot, const boolean state) {
+  if (slot < 0 || slot >= MAX_RELAYS) {
+    return;
+  }
+
+  const uint8_t mask    = (1 << slot);
+  const boolean current = (_record.states & mask) != 0;
+  if (current == state) {
+    return;
+  }
+
+  if (state) {
+    _record.states |= mask;
+  } else {
+    _record.states &= ~mask;
+  }
+  _dirty      = true;
+  _lastChange = millis();
+}
+
+/**
+ * Remember the counters of a slot. Urgent changes are committed like state changes,
+ * others at most every STATS_INTERVAL.
+ */
+void RelayStateStore::setStatistics(const int8_t slot, const RelayStatistics& statistics, const boolean urgent) {
+  if (slot < 0 || slot >= MAX_RELAYS) {
+    return;
+  }
+
+  _statsRecord.statistics[slot] = statistics;
+  _statsDirty                   = true;
+  if (urgent) {
+    _statsUrgent     = true;
+    _lastStatsChange = millis();
+  }
+}
+
+/**
+ * Commit pending changes once they have settled.
+ */
+void RelayStateStore::loop() {
+  if (_dirty && millis() - _lastChange >= COMMIT_DELAY) {
+    if (flashJournal.write(RECORD_RELAY_STATE, &_record, sizeof(_record))) {
+      _dirty = false;
+    } else {
+      // retry after another delay
+      _lastChange = millis();
+    }
+  }
+
+  if (_statsDirty && ((_statsUrgent && millis() - _lastStatsChange >= COMMIT_DELAY) ||
+                      millis() - _lastStatsWrite >= STATS_INTERVAL)) {
+    writeStatistics();
+  }
+}
+
+/**
+ * Commit pending changes now, e.g. before a restart.
+ */
+void RelayStateStore::flush() {
+  if (_dirty && flashJournal.write(RECORD_RELAY_STATE, &_record, sizeof(_record))) {
+    _dirty = false;
+  }
+  if (_statsDirty) {
+    writeStatistics();
+  }
+}
+
+/**
+ *
+ */
+void RelayStateStore::writeStatistics() {
+  // on failure retry with the next interval
+  _lastStatsWrite = millis();
+  _statsUrgent    = false;
+
+  if (flashJournal.write(RECORD_RELAY_STATS, &_statsRecord, sizeof(_statsRecord))) {
+    _statsDirty = false;
+  }
+}
+
+/**
+ *
+ */
+void RelayStateStore::load() {
+  if (_loaded) {
+    return;
+  }
+  _loaded = true;
+
+  if (!flashJournal.read(RECORD_RELAY_STATE, &_record, sizeof(_record))) {
+    memset(&_record, 0, sizeof(_record));
+    Homie.getLogger() << FPSTR(cIndent) << F("RelayStateStore: no stored relay states") << endl;
+  }
+  if (!flashJournal.read(RECORD_RELAY_STATS, &_statsRecord, sizeof(_statsRecord))) {
+    memset(&_statsRecord, 0, sizeof(_statsRecord));
+  }
+  _lastStatsWrite = millis();
+}
+
+/**
+ * 16 bit FNV-1a of the node id, never 0.
+ */
+uint16_t RelayStateStore::hashId(const char* id) {
+  uint32_t hash = 2166136261UL;
+  while (*id) {
+    hash ^= static_cast<uint8_t>(*id++);
+    hash *= 16777619UL;
+  }
+  const uint16_t folded = static_cast<uint16_t>((hash >> 16) ^ (hash & 0xFFFF));
+  return folded ? folded : 1;
+}
@@ -0,0 +1,75 @@
+/**
+ * Persistent switch states and statistics of all relays.
+ *
+ * Relays attach by node id and get restored from the latest journal records.
+ * State changes only mark the store dirty; loop() writes one record for all
+ * relays once the states have been stable for COMMIT_DELAY, so a rule switching
+ * both pumps in one evaluation costs a single flash write.
+ *
+ * Statistics change every second while a pump runs. They are written at most
+ * every STATS_INTERVAL, or after COMMIT_DELAY for events worth keeping right
+ * away (pump stopped, new day).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "FlashJournal.hpp"
+#include "NodeStrings.hpp"
+
+/**
+ * Runtime counters of one relay.
+ */
+struct RelayStatistics {
+  uint32_t onTimeTotal;  // in seconds
+  uint32_t onTimeToday;  // in seconds
+  uint32_t cycles;       // number of starts
+  uint32_t energy;       // estimated, in Wh
+  uint16_t day;          // local day onTimeToday belongs to, 0 if unknown
+  uint16_t reserved;
+};
+
+class RelayStateStore {
+
+public:
+  static const uint8_t MAX_RELAYS = 8;
+
+  RelayStateStore();
+
+  int8_t attach(const char* id, boolean* storedState, RelayStatistics* storedStatistics);
+  void   setState(const int8_t slot, const boolean state);
+  void   setStatistics(const int8_t slot, const RelayStatistics& statistics, const boolean urgent);
+  void   loop();
+  void   flush();
+
+private:
+  static const unsigned long COMMIT_DELAY   = 2000;            // in ms
+  static const unsigned long STATS_INTERVAL = 15 * 60 * 1000UL;  // in ms
+
+  struct Record {
+    uint16_t idHash[MAX_RELAYS];  // identifies the relay of each slot, 0 if unused
+    uint8_t  states;              // bit n: state of slot n
+    uint8_t  reserved;
+  };
+
+  struct StatsRecord {
+    RelayStatistics statistics[MAX_RELAYS];  // same slots as Record
+  };
+
+  Record        _record;
+  bool          _loaded;
+  bool          _dirty;
+  unsigned long _lastChange;
+
+  StatsRecord   _statsRecord;
+  bool          _statsDirty;
+  bool          _statsUrgent;
+  unsigned long _lastStatsChange;
+  unsigned long _lastStatsWrite;
+
+  void            load();
+  void            writeStatistics();
+  static uint16_t hashId(const char* id);
+};
+
+extern RelayStateStore relayStateStore;
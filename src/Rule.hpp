@@ -1,26 +1,31 @@
-
 #pragma once
 
 #include "Timer.hpp"
+#include "Temperature.hpp"
 
+/**
+ * Temperatures are in centi-degrees, see Temperature.hpp.
+ */
 class Rule {
 
 public:
-  Rule() : _poolTemp(0.0), _solarTemp(0.0), _poolMaxTemp(0.0), _solarMinTemp(0.0), _hysteresis(0.0){};
-
-  void  setPoolTemperature(float temp) { _poolTemp = temp; };
-  float getPoolTemperature() { return _poolTemp; };
-  void  setSolarTemperature(float temp) { _solarTemp = temp; };
-  float getSolarTemperature() { return _solarTemp; };
+  Rule()
+      : _poolTemp(TEMPERATURE_INVALID), _solarTemp(TEMPERATURE_INVALID), _thresholds(makeThresholds(0, 0, 0)){};
 
-  void  setPoolMaxTemperature(float temp) { _poolMaxTemp = temp; };
-  float getPoolMaxTemperature() { return _poolMaxTemp; };
+  void    setPoolTemperature(int16_t temp) { _poolTemp = temp; };
+  int16_t getPoolTemperature() { return _poolTemp; };
+  void    setSolarTemperature(int16_t temp) { _solarTemp = temp; };
+  int16_t getSolarTemperature() { return _solarTemp; };
 
-  void  setSolarMinTemperature(float temp) { _solarMinTemp = temp; };
-  float getSolarMinTemperature() { return _solarMinTemp; };
+  /**
+   * Settings with the derived hysteresis thresholds, computed by the caller when a setting changes.
+   */
+  void                         setThresholds(const TemperatureThresholds& thresholds) { _thresholds = thresholds; };
+  const TemperatureThresholds& getThresholds() { return _thresholds; };
 
-  void  setTemperatureHysteresis(float temp) { _hysteresis = temp; };
-  float getTemperatureHysteresis() { return _hysteresis; };
+  int16_t getPoolMaxTemperature() { return _thresholds.poolMax; };
+  int16_t getSolarMinTemperature() { return _thresholds.solarMin; };
+  int16_t getTemperatureHysteresis() { return _thresholds.hysteresis; };
 
   void         setTimerSetting(TimerSetting setting) { _timerSetting = setting; };
   TimerSetting getTimerSetting() { return _timerSetting; };
@@ -32,13 +37,12 @@ public:
   virtual void        loop();
 
 protected:
-  float _poolTemp;
-  float _solarTemp;
-
-  float _poolMaxTemp;
-  float _solarMinTemp;
+  int16_t _poolTemp;
+  int16_t _solarTemp;
 
-  float _hysteresis;
+  TemperatureThresholds _thresholds;
 
   TimerSetting _timerSetting;
+
+  bool temperaturesValid() { return _poolTemp != TEMPERATURE_INVALID && _solarTemp != TEMPERATURE_INVALID; };
 };
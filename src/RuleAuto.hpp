@@ -4,6 +4,7 @@
 #include "Rule.hpp"
 #include "RelayModuleNode.hpp"
 #include "TimeClientHelper.hpp"
+#include "NodeStrings.hpp"
 
 class RuleAuto : public Rule {
 public:
@@ -17,12 +18,12 @@ public:
   virtual void loop();
 
 protected:
-  bool checkPoolPumpTimer();
+  bool         checkPoolPumpTimer();
+  virtual bool checkPoolPump() { return checkPoolPumpTimer(); };
 
-private:
   RelayModuleNode* _solarRelay;
   RelayModuleNode* _poolRelay;
 
-  const char* cCaption = "• RuleAuto:";
-  const char* cIndent  = "  ◦ ";
+private:
+  static const char cCaption[];
 };
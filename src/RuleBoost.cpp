@@ -1,6 +1,8 @@
 
 #include "RuleBoost.hpp"
 
+const char RuleBoost::cCaption[] PROGMEM = "• RuleBoost:";
+
 /**
  *
  */
@@ -13,23 +15,28 @@ RuleBoost::RuleBoost(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay) {
  *
  */
 void RuleBoost::loop() {
-  Homie.getLogger() << cIndent << F("§ RuleBoost: loop") << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("§ RuleBoost: loop") << endl;
   if (_poolRelay->getSwitch()) {
-    if ((!_solarRelay->getSwitch()) && (getPoolTemperature() < (getPoolMaxTemperature() - getTemperatureHysteresis())) &&
-        (getPoolTemperature() < (getSolarTemperature() - getTemperatureHysteresis()))) {
-      Homie.getLogger() << cIndent << F("§ RuleBoost: below max. Temperature. Switch solar on") << endl;
+    const TemperatureThresholds& t = getThresholds();
+
+    if (!temperaturesValid()) {
+      // no change of status
+
+    } else if ((!_solarRelay->getSwitch()) && (getPoolTemperature() < t.poolMaxOn) &&
+               (getSolarTemperature() - getPoolTemperature() > t.hysteresis)) {
+      Homie.getLogger() << FPSTR(cIndent) << F("§ RuleBoost: below max. Temperature. Switch solar on") << endl;
       _solarRelay->setSwitch(true);
 
-    } else if ((_solarRelay->getSwitch()) && (getPoolTemperature() > (getPoolMaxTemperature() + getTemperatureHysteresis())) &&
-               (getPoolTemperature() > (getSolarTemperature() + getTemperatureHysteresis()))) {
-      Homie.getLogger() << cIndent << F("§ RuleBoost: Max. Temperature reached. Switch solar off") << endl;
+    } else if ((_solarRelay->getSwitch()) && (getPoolTemperature() > t.poolMaxOff) &&
+               (getPoolTemperature() - getSolarTemperature() > t.hysteresis)) {
+      Homie.getLogger() << FPSTR(cIndent) << F("§ RuleBoost: Max. Temperature reached. Switch solar off") << endl;
       _solarRelay->setSwitch(false);
 
     } else {
       // no change of status
     }
   } else {
-    Homie.getLogger() << cIndent << F("§ RuleBoost: pool pump is disabled.") << endl;
+    Homie.getLogger() << FPSTR(cIndent) << F("§ RuleBoost: pool pump is disabled.") << endl;
     if (_solarRelay->getSwitch()) {
       _solarRelay->setSwitch(false);
     }
@@ -3,6 +3,7 @@
 
 #include "Rule.hpp"
 #include "RelayModuleNode.hpp"
+#include "NodeStrings.hpp"
 
 class RuleBoost : public Rule {
 public:
@@ -20,6 +21,5 @@ protected:
   RelayModuleNode* _poolRelay;
 
 private:
-  const char* cCaption = "• RuleBoost:";
-  const char* cIndent  = "  ◦ ";
+  static const char cCaption[];
 };
@@ -0,0 +1,72 @@
+#include "RuleFiltration.hpp"
+
+/**
+ *
+ */
+RuleFiltration::RuleFiltration(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay) : RuleAuto(solarRelay, poolRelay) {
+  _poolVolume = 0.0;
+  _pumpFlow   = 0.0;
+}
+
+/**
+ * Required number of pool volume turnovers per day in 1/100, depending on the water temperature.
+ */
+uint16_t RuleFiltration::turnoversPerDay() {
+  const int16_t temp = getPoolTemperature();
+
+  if (temp == TEMPERATURE_INVALID) {
+    return 200;
+  } else if (temp < centiFromDegrees(15)) {
+    return 100;
+  } else if (temp < centiFromDegrees(25)) {
+    return 100 + (temp - centiFromDegrees(15)) / 10;
+  } else if (temp < centiFromDegrees(30)) {
+    return 200 + (temp - centiFromDegrees(25)) / 5;
+  } else {
+    return 300;
+  }
+}
+
+/**
+ * Required pump runtime of the day in seconds, 0 if volume or flow are not configured.
+ */
+uint32_t RuleFiltration::getRequiredRuntime() {
+  if (_poolVolume <= 0.0 || _pumpFlow <= 0.0) {
+    return 0;
+  }
+
+  const float hours = turnoversPerDay() * _poolVolume / _pumpFlow / 100;
+  return (hours >= 24.0) ? 24 * 3600UL : (uint32_t)(hours * 3600.0);
+}
+
+/**
+ *
+ */
+bool RuleFiltration::checkPoolPump() {
+  Homie.getLogger() << F("↕  checkPoolPump (filter)") << endl;
+
+  if (_poolVolume <= 0.0 || _pumpFlow <= 0.0) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ pool volume or pump flow not configured, using timer") << endl;
+    return checkPoolPumpTimer();
+  }
+
+  const uint16_t day = getCurrentDay();
+  if (day == 0) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ time unknown, pool pump unchanged") << endl;
+    return _poolRelay->getRequestedSwitch();
+  }
+
+  tm             time        = getCurrentDateTime();
+  const uint32_t secondOfDay = time.tm_hour * 3600UL + time.tm_min * 60UL + time.tm_sec;
+  const uint32_t required    = getRequiredRuntime();
+  const uint32_t done        = _poolRelay->getStatistics().onTimeToday;
+
+  _planner.update(day, secondOfDay, required, done);
+
+  const bool retval = _planner.isPlanned(secondOfDay / FiltrationPlanner::SLOT_SECONDS);
+
+  Homie.getLogger() << FPSTR(cIndent) << F("required=") << required << F(" s, done=") << done << F(" s, planned slots=")
+                    << _planner.getPlannedCount() << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("checkPoolPump = ") << retval << endl;
+  return retval;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "RuleAuto.hpp"
+#include "FiltrationPlanner.hpp"
+#include "NodeStrings.hpp"
+
+/**
+ * Runs the pool pump long enough to turn the pool volume over as often as the
+ * water temperature requires, in the sunniest/cheapest slots of the day.
+ * Solar heating works like in RuleAuto while the pool pump runs.
+ */
+class RuleFiltration : public RuleAuto {
+public:
+  RuleFiltration(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay);
+
+  const char* getMode() { return "filter"; };
+
+  void  setPoolVolume(float volume) { _poolVolume = volume; };
+  float getPoolVolume() { return _poolVolume; };
+  void  setPumpFlow(float flow) { _pumpFlow = flow; };
+  float getPumpFlow() { return _pumpFlow; };
+
+  uint32_t           getRequiredRuntime();
+  FiltrationPlanner& getPlanner() { return _planner; };
+
+protected:
+  virtual bool checkPoolPump();
+
+private:
+  float             _poolVolume;  // in m³
+  float             _pumpFlow;    // in m³/h
+  FiltrationPlanner _planner;
+
+  uint16_t turnoversPerDay();
+};
@@ -0,0 +1,167 @@
+#include "RulePredictive.hpp"
+
+const char RulePredictive::cCaption[] PROGMEM = "• RulePredictive:";
+
+const float RulePredictive::FORGETTING       = 0.98f;    // about 50 windows of memory
+const float RulePredictive::COVARIANCE_LIMIT = 1000.0f;  // no forgetting above, against wind-up
+
+/**
+ *
+ */
+RulePredictive::RulePredictive(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay) : RuleAuto(solarRelay, poolRelay) {
+  _horizon         = 30;
+  _theta[0]        = 0.0f;
+  _theta[1]        = 0.0f;
+  _p[0][0]         = 10.0f;
+  _p[0][1]         = 0.0f;
+  _p[1][0]         = 0.0f;
+  _p[1][1]         = 10.0f;
+  _samplesOn       = 0;
+  _samplesOff      = 0;
+  _windowValid     = false;
+  _windowSolarOn   = false;
+  _windowStart     = 0;
+  _windowPool      = TEMPERATURE_INVALID;
+  _differenceSum   = 0;
+  _differenceCount = 0;
+}
+
+/**
+ * Enough windows of both pump states, and a collector which heats at all.
+ */
+bool RulePredictive::isTrained() const {
+  return _samplesOn >= MIN_SAMPLES && _samplesOff >= MIN_SAMPLES && _theta[1] > 0.0f;
+}
+
+/**
+ * Heat the collector adds to the pool over the horizon if the solar pump runs, from the current temperatures.
+ * The loss is left out, the pool loses it with the pump off as well.
+ */
+int16_t RulePredictive::predictGain() {
+  const float difference = (getSolarTemperature() - getPoolTemperature()) / 100.0f;
+  const float rise       = _theta[1] * difference * _horizon / 60.0f;
+
+  return (rise > 100.0f) ? 10000 : (rise < -100.0f) ? -10000 : (int16_t)(rise * 100.0f);
+}
+
+/**
+ *
+ */
+void RulePredictive::loop() {
+  Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: loop") << endl;
+
+  learn();
+  Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: loss=") << _theta[0] << F(" K/h, gain=") << _theta[1]
+                    << F(" 1/h, windows on/off=") << _samplesOn << F("/") << _samplesOff << endl;
+
+  if (!isTrained()) {
+    Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: model not trained, using RuleAuto") << endl;
+    RuleAuto::loop();
+    return;
+  }
+
+  _poolRelay->setSwitch(checkPoolPump());
+
+  if (!_poolRelay->getSwitch()) {
+    if (_solarRelay->getSwitch()) {
+      Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: pool pump is disabled. Switch solar off") << endl;
+      _solarRelay->setSwitch(false);
+    }
+    return;
+  }
+
+  if (!temperaturesValid()) {
+    Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: no valid temperature -> no change") << endl;
+    return;
+  }
+
+  const TemperatureThresholds& t    = getThresholds();
+  const int16_t                gain = predictGain();
+  Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: predicted gain ") << CentiDegrees(gain) << F(" K in ")
+                    << _horizon << F(" min") << endl;
+
+  if (_solarRelay->getSwitch()) {
+    if (getPoolTemperature() >= t.poolMaxOff) {
+      Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: Pool temp. (") << CentiDegrees(getPoolTemperature())
+                        << F(") above max. temperature (") << CentiDegrees(t.poolMax) << F("). Switch solar off") << endl;
+      _solarRelay->setSwitch(false);
+
+    } else if (gain <= 0) {
+      Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: no gain from the collector. Switch solar off") << endl;
+      _solarRelay->setSwitch(false);
+    }
+
+  } else if (getPoolTemperature() <= t.poolMax && gain >= MIN_GAIN) {
+    Homie.getLogger() << FPSTR(cIndent) << F("§ RulePredictive: gain from the collector expected. Switch solar on") << endl;
+    _solarRelay->setSwitch(true);
+  }
+}
+
+/**
+ * Collect the temperatures of the window; a complete window is one sample of the model. Windows end early
+ * when the solar pump switched, the pool pump stopped (the pool sensor sits in the pipe) or a reading is missing.
+ */
+void RulePredictive::learn() {
+  if (!temperaturesValid() || !_poolRelay->getSwitch()) {
+    _windowValid = false;
+    return;
+  }
+  if (!_windowValid || _solarRelay->getSwitch() != _windowSolarOn) {
+    startWindow();
+    return;
+  }
+
+  _differenceSum += getSolarTemperature() - getPoolTemperature();
+  _differenceCount++;
+
+  const unsigned long duration = millis() - _windowStart;
+  if (duration < SAMPLE_INTERVAL) {
+    return;
+  }
+
+  const float hours      = duration / 3600000.0f;
+  const float rate       = (getPoolTemperature() - _windowPool) / 100.0f / hours;
+  const float difference = _windowSolarOn ? _differenceSum / 100.0f / _differenceCount : 0.0f;
+  update(difference, rate);
+
+  if (_windowSolarOn) {
+    _samplesOn += (_samplesOn < UINT8_MAX) ? 1 : 0;
+  } else {
+    _samplesOff += (_samplesOff < UINT8_MAX) ? 1 : 0;
+  }
+  startWindow();
+}
+
+/**
+ *
+ */
+void RulePredictive::startWindow() {
+  _windowValid     = true;
+  _windowSolarOn   = _solarRelay->getSwitch();
+  _windowStart     = millis();
+  _windowPool      = getPoolTemperature();
+  _differenceSum   = getSolarTemperature() - getPoolTemperature();
+  _differenceCount = 1;
+}
+
+/**
+ * One step of recursive least squares with regressor (-1, difference) and the observed rate in K/h.
+ */
+void RulePredictive::update(const float difference, const float rate) {
+  const float phi[2]  = {-1.0f, difference};
+  const float pPhi[2] = {_p[0][0] * phi[0] + _p[0][1] * phi[1], _p[1][0] * phi[0] + _p[1][1] * phi[1]};
+  const float forget  = (_p[0][0] + _p[1][1] < COVARIANCE_LIMIT) ? FORGETTING : 1.0f;
+  const float denom   = forget + phi[0] * pPhi[0] + phi[1] * pPhi[1];
+  const float k[2]    = {pPhi[0] / denom, pPhi[1] / denom};
+  const float error   = rate - (_theta[0] * phi[0] + _theta[1] * phi[1]);
+
+  _theta[0] += k[0] * error;
+  _theta[1] += k[1] * error;
+
+  // P = (P - k phi' P) / forget, phi' P is pPhi' since P is symmetric
+  for (uint8_t i = 0; i < 2; i++) {
+    for (uint8_t j = 0; j < 2; j++) {
+      _p[i][j] = (_p[i][j] - k[i] * pPhi[j]) / forget;
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "RuleAuto.hpp"
+#include "NodeStrings.hpp"
+
+/**
+ * Switches the solar pump by a thermal model of the pool instead of fixed
+ * thresholds: the pool temperature changes by
+ *
+ *   dT/dt = -loss + gain * (solar - pool)   while the solar pump runs
+ *   dT/dt = -loss                           otherwise (in K/h)
+ *
+ * Loss rate and collector gain are fitted online by recursive least squares
+ * with forgetting, from the rise of the pool temperature over windows of
+ * SAMPLE_INTERVAL with an unchanged pump state. The solar pump starts when
+ * the collector is predicted to add at least MIN_GAIN over the horizon,
+ * gain * (solar - pool) * horizon, and stops when it adds nothing anymore or
+ * the pool reaches its maximum temperature. The loss is left out of the
+ * decision, the pool loses that heat with the pump off as well. Until
+ * enough windows with the pump on and off have been seen the rule behaves
+ * like RuleAuto. The pool pump follows the timer like in RuleAuto.
+ *
+ * The model is float: it is updated once per window, evaluated once per loop().
+ */
+class RulePredictive : public RuleAuto {
+public:
+  static const unsigned long SAMPLE_INTERVAL = 15 * 60 * 1000UL;  // in ms
+  static const uint8_t       MIN_SAMPLES     = 4;                  // windows each with pump on and off
+  static const int16_t       MIN_GAIN        = 5;                  // in centi-degrees over the horizon
+
+  RulePredictive(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay);
+
+  const char* getMode() { return "predict"; };
+
+  void     setHorizon(uint16_t minutes) { _horizon = minutes; };
+  uint16_t getHorizon() { return _horizon; };
+
+  float   getLossRate() const { return _theta[0]; }  // in K/h
+  float   getGain() const { return _theta[1]; }      // in 1/h
+  bool    isTrained() const;
+  int16_t predictGain();  // added by the collector, in centi-degrees over the horizon
+
+  virtual void loop();
+
+private:
+  static const float FORGETTING;
+  static const float COVARIANCE_LIMIT;
+
+  static const char cCaption[];
+
+  uint16_t _horizon;  // in minutes
+
+  float   _theta[2];  // loss rate, gain
+  float   _p[2][2];   // covariance
+  uint8_t _samplesOn;
+  uint8_t _samplesOff;
+
+  // window in progress
+  bool          _windowValid;
+  bool          _windowSolarOn;
+  unsigned long _windowStart;  // millis()
+  int16_t       _windowPool;
+  int32_t       _differenceSum;  // solar - pool, in centi-degrees
+  uint16_t      _differenceCount;
+
+  void learn();
+  void startWindow();
+  void update(const float difference, const float rate);
+};
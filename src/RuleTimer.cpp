@@ -1,6 +1,8 @@
 
 #include "RuleTimer.hpp"
 
+const char RuleTimer::cCaption[] PROGMEM = "• RuleTimer:";
+
 /**
  *
  */
@@ -15,7 +17,7 @@ RuleTimer::RuleTimer(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay) {
  *
  */
 void RuleTimer::loop() {
-  Homie.getLogger() << cIndent << F("§ RuleTimer: loop") << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("§ RuleTimer: loop") << endl;
 
   _poolRelay->setSwitch(checkPoolPumpTimer());
 
@@ -31,15 +33,20 @@ void RuleTimer::loop() {
 bool RuleTimer::checkPoolPumpTimer() {
   Homie.getLogger() << F("↕  checkPoolPumpTimer") << endl;
 
+  if (!isTimeKnown()) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ time unknown, pool pump unchanged") << endl;
+    return _poolRelay->getRequestedSwitch();
+  }
+
   tm  time = getCurrentDateTime();
   bool retval;
 
   tm startTime = getStartTime(getTimerSetting());
   tm endTime   = getEndTime(getTimerSetting());
 
-  Homie.getLogger() << cIndent << F("time=      ") << asctime(&time);
-  Homie.getLogger() << cIndent << F("startTime= ") << asctime(&startTime);
-  Homie.getLogger() << cIndent << F("endTime=   ") << asctime(&endTime);
+  Homie.getLogger() << FPSTR(cIndent) << F("time=      ") << asctime(&time);
+  Homie.getLogger() << FPSTR(cIndent) << F("startTime= ") << asctime(&startTime);
+  Homie.getLogger() << FPSTR(cIndent) << F("endTime=   ") << asctime(&endTime);
 
   if (difftime(mktime(&time), mktime(&startTime)) >= 0
     && difftime(mktime(&time), mktime(&endTime)) <= 0) {
@@ -49,7 +56,7 @@ bool RuleTimer::checkPoolPumpTimer() {
     retval = false;
   }
 
-  Homie.getLogger() << cIndent << F("checkPoolPumpTimer = ") << retval << endl;
+  Homie.getLogger() << FPSTR(cIndent) << F("checkPoolPumpTimer = ") << retval << endl;
   return retval;
 }
 
@@ -4,6 +4,7 @@
 #include "Rule.hpp"
 #include "RelayModuleNode.hpp"
 #include "TimeClientHelper.hpp"
+#include "NodeStrings.hpp"
 
 class RuleTimer : public Rule {
 public:
@@ -23,6 +24,5 @@ private:
   RelayModuleNode* _solarRelay;
   RelayModuleNode* _poolRelay;
 
-  const char* cCaption = "• RuleTimer:";
-  const char* cIndent  = "  ◦ ";
+  static const char cCaption[];
 };
@@ -0,0 +1,139 @@
+/**
+ * 1-Wire acquisition in its own FreeRTOS task (ESP32 only).
+ */
+#include "SensorTask.hpp"
+
+#if SENSOR_TASK
+
+#include <algorithm>
+#include <Homie.hpp>
+#include "DallasTemperatureNode.hpp"
+
+SensorTask sensorTask;
+
+/**
+ *
+ */
+SensorTask::SensorTask() : _dropped(0) {
+  _count  = 0;
+  _handle = NULL;
+  memset(_filters, 0, sizeof(_filters));
+}
+
+/**
+ * Register a node before begin().
+ */
+void SensorTask::add(DallasTemperatureNode* node) {
+  if (_handle == NULL && _count < MAX_SENSORS) {
+    _nodes[_count++] = node;
+  }
+}
+
+/**
+ * Start the task; the nodes must have been initialized with begin().
+ */
+bool SensorTask::begin() {
+  if (_handle != NULL) {
+    return true;
+  }
+
+  // one priority above the loop task, it sleeps most of the time
+  const BaseType_t result = xTaskCreatePinnedToCore(run, "sensors", STACK_SIZE, this, 2, &_handle, SENSOR_TASK_CORE);
+  if (result != pdPASS) {
+    Homie.getLogger() << F("✖ Sensor task not started") << endl;
+    _handle = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Hand the queued readings to the nodes. Main loop only; returns the number of readings.
+ */
+uint8_t SensorTask::drain() {
+  SensorReading reading;
+  uint8_t       count = 0;
+
+  while (_readings.pop(reading)) {
+    _nodes[reading.sensor]->setTemperature(reading.temperature);
+    count++;
+  }
+
+  return count;
+}
+
+/**
+ *
+ */
+void SensorTask::run(void* self) {
+  SensorTask* task     = static_cast<SensorTask*>(self);
+  TickType_t  lastWake = xTaskGetTickCount();
+
+  while (true) {
+    task->acquire();
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAMPLE_INTERVAL));
+  }
+}
+
+/**
+ * One measurement of all sensors; the buses convert in parallel.
+ */
+void SensorTask::acquire() {
+  unsigned long conversionTime = 0;
+
+  for (uint8_t i = 0; i < _count; i++) {
+    _nodes[i]->requestConversion();
+    const unsigned long time = _nodes[i]->getConversionTime();
+    if (time > conversionTime) {
+      conversionTime = time;
+    }
+  }
+
+  vTaskDelay(pdMS_TO_TICKS(conversionTime));
+
+  for (uint8_t i = 0; i < _count; i++) {
+    SensorReading reading;
+    reading.sensor      = i;
+    reading.temperature = filter(i, _nodes[i]->readConversion());
+
+    if (!_readings.push(reading)) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * Median of the last FILTER_SIZE valid samples; TEMPERATURE_INVALID once the sensor delivered no valid sample
+ * for FILTER_SIZE rounds.
+ */
+int16_t SensorTask::filter(const uint8_t sensor, const int16_t value) {
+  Filter& f = _filters[sensor];
+
+  if (value == TEMPERATURE_INVALID) {
+    if (f.count > 0) {
+      f.count--;
+    }
+  } else {
+    f.samples[f.next] = value;
+    f.next            = (f.next + 1) % FILTER_SIZE;
+    if (f.count < FILTER_SIZE) {
+      f.count++;
+    }
+  }
+
+  if (f.count == 0) {
+    return TEMPERATURE_INVALID;
+  }
+  if (f.count < FILTER_SIZE) {
+    // not enough samples for a median yet, use the newest
+    return f.samples[(f.next + FILTER_SIZE - 1) % FILTER_SIZE];
+  }
+
+  const int16_t a = f.samples[0];
+  const int16_t b = f.samples[1];
+  const int16_t c = f.samples[2];
+  return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+#endif
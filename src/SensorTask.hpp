@@ -0,0 +1,80 @@
+/**
+ * 1-Wire acquisition in its own FreeRTOS task (ESP32 only).
+ *
+ * Build with -D SENSOR_TASK=1. The task, pinned to SENSOR_TASK_CORE, starts
+ * the conversion on all buses, sleeps while the sensors convert, reads them
+ * and filters each sensor with a median of its last three valid samples, so
+ * a single bad read never reaches the rules. Readings are handed to the main
+ * loop through a lock-free single-producer/single-consumer ring; the
+ * operation mode node drains it before the rules look at the temperatures.
+ * The bit-banged bus timing never runs in the loop task, and the control
+ * loop never waits for a bus transaction.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef SENSOR_TASK
+#define SENSOR_TASK 0
+#endif
+
+#if SENSOR_TASK
+
+#ifndef ESP32
+#error "SENSOR_TASK needs an ESP32"
+#endif
+
+#ifndef SENSOR_TASK_CORE
+#define SENSOR_TASK_CORE 0
+#endif
+
+#include <atomic>
+#include "SpscRing.hpp"
+
+class DallasTemperatureNode;
+
+struct SensorReading {
+  uint8_t sensor;       // index of the node in the task
+  int16_t temperature;  // centi-degrees
+};
+
+class SensorTask {
+
+public:
+  static const uint8_t       MAX_SENSORS     = 4;
+  static const unsigned long SAMPLE_INTERVAL = 5000;  // in ms
+  static const uint32_t      STACK_SIZE      = 4096;  // in bytes
+
+  SensorTask();
+
+  void     add(DallasTemperatureNode* node);
+  bool     begin();
+  uint8_t  drain();
+  uint32_t getDropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  static const uint8_t FILTER_SIZE = 3;
+
+  struct Filter {
+    int16_t samples[FILTER_SIZE];
+    uint8_t count;
+    uint8_t next;
+  };
+
+  DallasTemperatureNode* _nodes[MAX_SENSORS];
+  uint8_t                _count;
+  Filter                 _filters[MAX_SENSORS];  // used by the task only
+
+  SpscRing<SensorReading, 8> _readings;
+  std::atomic<uint32_t>      _dropped;  // readings lost because the main loop did not drain in time
+  TaskHandle_t               _handle;
+
+  static void run(void* self);
+  void        acquire();
+  int16_t     filter(const uint8_t sensor, const int16_t value);
+};
+
+extern SensorTask sensorTask;
+
+#endif
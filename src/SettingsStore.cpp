@@ -0,0 +1,109 @@
+/**
+ * Persistent runtime settings of the control core.
+ */
+#include "SettingsStore.hpp"
+#include <Homie.hpp>
+#include "DeadlineScheduler.hpp"
+
+SettingsStore settingsStore;
+
+/**
+ *
+ */
+SettingsStore::SettingsStore() {
+  memset(&_record, 0, sizeof(_record));
+  _loaded     = false;
+  _dirty      = false;
+  _commitTask = DeadlineScheduler::INVALID_TASK;
+  _writeCount = 0;
+}
+
+/**
+ * Settings to start with: the persisted ones if valid and based on the same
+ * configuration, otherwise the configured ones. Returns true for persisted settings.
+ */
+bool SettingsStore::load(ControlSettings& settings, const ControlSettings& configured) {
+  const uint16_t configHash = hash(configured);
+
+  if (_commitTask == DeadlineScheduler::INVALID_TASK) {
+    _commitTask = scheduler.addOneShot("settings-store", commitTask, this, COMMIT_DELAY);
+    scheduler.cancel(_commitTask);
+  }
+
+  Record     stored;
+  const bool valid = flashJournal.read(RECORD_SETTINGS, &stored, sizeof(stored)) && stored.version == VERSION;
+  _loaded          = true;
+
+  if (valid && stored.configHash == configHash) {
+    _record  = stored;
+    settings = _record.settings;
+    Homie.getLogger() << FPSTR(cIndent) << F("SettingsStore: using stored settings") << endl;
+    return true;
+  }
+
+  if (valid) {
+    Homie.getLogger() << FPSTR(cIndent) << F("SettingsStore: configuration changed, stored settings dropped") << endl;
+  }
+  _record.version    = VERSION;
+  _record.configHash = configHash;
+  _record.settings   = configured;
+  settings           = configured;
+  return false;
+}
+
+/**
+ * Remember changed settings, written COMMIT_DELAY after the last change.
+ */
+void SettingsStore::update(const ControlSettings& settings) {
+  if (!_loaded || memcmp(&settings, &_record.settings, sizeof(ControlSettings)) == 0) {
+    return;
+  }
+
+  _record.settings = settings;
+  _dirty           = true;
+
+  // restart the delay: trigger() only moves a deadline forward
+  scheduler.cancel(_commitTask);
+  scheduler.trigger(_commitTask, COMMIT_DELAY);
+}
+
+/**
+ * Write pending changes now, e.g. before a restart.
+ */
+void SettingsStore::flush() {
+  if (_dirty) {
+    scheduler.cancel(_commitTask);
+    commit();
+  }
+}
+
+/**
+ *
+ */
+void SettingsStore::commit() {
+  if (!_dirty) {
+    return;
+  }
+
+  if (flashJournal.write(RECORD_SETTINGS, &_record, sizeof(_record))) {
+    _dirty = false;
+    _writeCount++;
+  } else {
+    // retry after another delay
+    scheduler.trigger(_commitTask, COMMIT_DELAY);
+  }
+}
+
+/**
+ * 16 bit FNV-1a of the settings, unused bytes of the mode included.
+ */
+uint16_t SettingsStore::hash(const ControlSettings& settings) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(&settings);
+  uint32_t       hash = 2166136261UL;
+
+  for (size_t i = 0; i < sizeof(ControlSettings); i++) {
+    hash ^= data[i];
+    hash *= 16777619UL;
+  }
+  return static_cast<uint16_t>((hash >> 16) ^ (hash & 0xFFFF));
+}
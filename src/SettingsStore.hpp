@@ -0,0 +1,67 @@
+/**
+ * Persistent runtime settings of the control core.
+ *
+ * Settings changed via MQTT (operation mode, temperatures, timer) are kept in
+ * one binary record of the flash journal, versioned and CRC protected by the
+ * journal. A change only marks the record dirty; it is written COMMIT_DELAY
+ * after the last change, so a burst of MQTT updates costs a single write.
+ *
+ * At boot the record replaces the values from the Homie configuration, unless
+ * the configuration itself was changed since the record was written: the
+ * record keeps a hash of the configured values it was based on.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "FlashJournal.hpp"
+#include "NodeStrings.hpp"
+
+/**
+ * Settings of OperationModeNode, temperatures in centi-degrees.
+ */
+struct ControlSettings {
+  char    mode[8];  // see OperationModeNode::STATUS_*
+  int16_t poolMax;
+  int16_t solarMin;
+  int16_t hysteresis;
+  uint8_t timerStartHour;
+  uint8_t timerStartMinutes;
+  uint8_t timerEndHour;
+  uint8_t timerEndMinutes;
+};
+
+class SettingsStore {
+
+public:
+  static const uint8_t       VERSION      = 1;      // increment on any change of ControlSettings
+  static const unsigned long COMMIT_DELAY = 10000;  // in ms
+
+  SettingsStore();
+
+  bool load(ControlSettings& settings, const ControlSettings& configured);
+  void update(const ControlSettings& settings);
+  void flush();
+
+  uint32_t getWriteCount() const { return _writeCount; }
+
+private:
+  struct Record {
+    uint8_t         version;
+    uint8_t         reserved;
+    uint16_t        configHash;  // of the configured settings the record is based on
+    ControlSettings settings;
+  };
+
+  Record   _record;
+  bool     _loaded;
+  bool     _dirty;
+  int8_t   _commitTask;
+  uint32_t _writeCount;
+
+  void            commit();
+  static void     commitTask(void* store) { static_cast<SettingsStore*>(store)->commit(); }
+  static uint16_t hash(const ControlSettings& settings);
+};
+
+extern SettingsStore settingsStore;
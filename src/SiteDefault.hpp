@@ -0,0 +1,32 @@
+/**
+ * Topology of the reference pool controller: two DS18B20 sensors, pool and solar pump.
+ *
+ * Copy this file for a site with other hardware and select it with
+ * build flag SITE_TOPOLOGY, see Topology.hpp.
+ */
+
+#pragma once
+
+#ifdef ESP32
+constexpr SensorSpec SENSORS[] = {
+    {"solar-temp", "Solar Temperature", 15, ROLE_SOLAR_TEMPERATURE},
+    {"pool-temp", "Pool Temperature", 16, ROLE_POOL_TEMPERATURE},
+};
+
+constexpr RelaySpec RELAYS[] = {
+    {"pool-pump", "Pool Pump", 18, ROLE_POOL_PUMP},
+    {"solar-pump", "Solar Pump", 19, ROLE_SOLAR_PUMP},
+};
+#elif defined(ESP8266)
+
+// see: https://randomnerdtutorials.com/esp8266-pinout-reference-gpios/
+constexpr SensorSpec SENSORS[] = {
+    {"solar-temp", "Solar Temperature", D5, ROLE_SOLAR_TEMPERATURE},
+    {"pool-temp", "Pool Temperature", D6, ROLE_POOL_TEMPERATURE},
+};
+
+constexpr RelaySpec RELAYS[] = {
+    {"pool-pump", "Pool Pump", D1, ROLE_POOL_PUMP},
+    {"solar-pump", "Solar Pump", D2, ROLE_SOLAR_PUMP},
+};
+#endif
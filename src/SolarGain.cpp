@@ -0,0 +1,117 @@
+/**
+ * Heat delivered to the pool by the solar heating.
+ */
+#include "SolarGain.hpp"
+
+/**
+ *
+ */
+SolarGain::SolarGain() {
+  _volumeFactor = 0;
+  _flowFactor   = 0;
+  _started      = false;
+  _collector    = false;
+  _lastSample   = 0;
+  _lastPool     = TEMPERATURE_INVALID;
+  _lastPumpOn   = false;
+  _lastPumpTime = 0;
+  _lastCycles   = 0;
+  _day          = 0;
+  _remainder    = 0;
+  _modeCount    = 0;
+  memset(&_today, 0, sizeof(_today));
+  memset(_modes, 0, sizeof(_modes));
+}
+
+/**
+ * 1163 Wh/(m³ K) are 11630 mWh per m³ and centi-degree.
+ */
+void SolarGain::setPoolVolume(const float volume) {
+  _volumeFactor = (volume > 0) ? (uint32_t)(volume * WATER_HEAT_CAPACITY * 10 + 0.5f) : 0;
+}
+
+/**
+ *
+ */
+void SolarGain::setFlow(const float flow) {
+  _flowFactor = (flow > 0) ? (uint32_t)(flow * WATER_HEAT_CAPACITY * 10 + 0.5f) : 0;
+}
+
+/**
+ * Add the heat since the previous sample. Temperatures in centi-degrees, inlet and outlet TEMPERATURE_INVALID
+ * without collector probes; pumpTime and cycles are the counters of the solar pump; day 0 while the time is unknown.
+ */
+void SolarGain::sample(const unsigned long now, const int16_t pool, const int16_t inlet, const int16_t outlet,
+                       const bool pumpOn, const uint32_t pumpTime, const uint32_t cycles, const char* mode,
+                       const uint16_t day) {
+  if (day != 0 && day != _day) {
+    if (_day != 0) {
+      // a new day, not just the first time sync ever
+      memset(&_today, 0, sizeof(_today));
+    }
+    _day = day;
+  }
+
+  int64_t energy = 0;  // in mWh
+  _collector     = (_flowFactor > 0 && inlet != TEMPERATURE_INVALID && outlet != TEMPERATURE_INVALID);
+
+  // heat only counts while the pump ran from the previous sample on
+  if (_started && pumpOn && _lastPumpOn) {
+    if (_collector) {
+      energy = (int64_t)_flowFactor * (outlet - inlet) * (int32_t)(now - _lastSample) / 3600000L;
+    } else if (_volumeFactor > 0 && pool != TEMPERATURE_INVALID && _lastPool != TEMPERATURE_INVALID) {
+      energy = (int64_t)_volumeFactor * (pool - _lastPool);
+    }
+  }
+
+  if (_started) {
+    // counters of the pump are restored at boot and never decrease
+    const uint32_t time   = (pumpTime >= _lastPumpTime) ? pumpTime - _lastPumpTime : 0;
+    const uint32_t starts = (cycles >= _lastCycles) ? cycles - _lastCycles : 0;
+    add(findMode(mode), energy, time, starts);
+  }
+
+  _started      = true;
+  _lastSample   = now;
+  _lastPool     = pool;
+  _lastPumpOn   = pumpOn;
+  _lastPumpTime = pumpTime;
+  _lastCycles   = cycles;
+}
+
+/**
+ * Totals of the mode, added if new; nullptr if the table is full.
+ */
+SolarGainTotals* SolarGain::findMode(const char* mode) {
+  for (uint8_t i = 0; i < _modeCount; i++) {
+    if (strcmp(_modes[i].name, mode) == 0) {
+      return &_modes[i].totals;
+    }
+  }
+  if (_modeCount >= MAX_MODES) {
+    return nullptr;
+  }
+
+  ModeTotals& entry = _modes[_modeCount++];
+  strncpy(entry.name, mode, MODE_SIZE - 1);
+  entry.name[MODE_SIZE - 1] = '\0';
+  return &entry.totals;
+}
+
+/**
+ * Add to the day and to the mode; whole Wh only, the rest is carried over.
+ */
+void SolarGain::add(SolarGainTotals* totals, const int64_t energy, const uint32_t pumpTime, const uint32_t cycles) {
+  const int64_t sum = _remainder + energy;
+  const int32_t wh  = (int32_t)(sum / 1000);
+  _remainder        = (int32_t)(sum - (int64_t)wh * 1000);
+
+  _today.energy += wh;
+  _today.pumpTime += pumpTime;
+  _today.cycles += cycles;
+  if (totals != nullptr) {
+    totals->energy += wh;
+    totals->pumpTime += pumpTime;
+    totals->cycles += cycles;
+  }
+}
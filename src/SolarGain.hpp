@@ -0,0 +1,81 @@
+/**
+ * Heat delivered to the pool by the solar heating, estimated from the temperatures.
+ *
+ * With a probe at the inlet and one at the outlet of the collector the heat
+ * is integrated from the flow and the temperature difference between them:
+ * P = flow * 1163 Wh/(m³ K) * (outlet - inlet). Without them the change of
+ * the pool temperature while the solar pump runs is taken:
+ * Q = volume * 1163 Wh/(m³ K) * (pool - previous pool), which is the net gain
+ * including the losses of the pool in that time.
+ *
+ * Each sample only updates a few counters: the energy of the day and the
+ * totals per operation mode, together with the runtime and starts of the
+ * solar pump, taken from the difference of its RelayStatistics. All integer;
+ * energy is kept in Wh, the rest below one Wh is carried over in mWh.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "Temperature.hpp"
+
+/**
+ * Heat gained while the solar pump ran.
+ */
+struct SolarGainTotals {
+  int32_t  energy;    // in Wh, negative if the pool lost heat
+  uint32_t pumpTime;  // in s
+  uint32_t cycles;    // pump starts
+
+  float getEnergyPerPumpHour() const { return (pumpTime > 0) ? energy * 3.6f / pumpTime : 0.0f; }  // in kWh/h
+  float getEnergyPerCycle() const { return (cycles > 0) ? energy / 1000.0f / cycles : 0.0f; }      // in kWh
+};
+
+class SolarGain {
+
+public:
+  static const uint8_t  MAX_MODES           = 6;
+  static const uint8_t  MODE_SIZE           = 8;
+  static const uint32_t WATER_HEAT_CAPACITY = 1163;  // in Wh/(m³ K)
+
+  SolarGain();
+
+  void setPoolVolume(const float volume);  // in m³
+  void setFlow(const float flow);          // in m³/h, through the collector
+  bool isConfigured() const { return _volumeFactor > 0 || _flowFactor > 0; }
+
+  void sample(const unsigned long now, const int16_t pool, const int16_t inlet, const int16_t outlet, const bool pumpOn,
+              const uint32_t pumpTime, const uint32_t cycles, const char* mode, const uint16_t day);
+
+  const SolarGainTotals& getToday() const { return _today; }
+  uint8_t                getModeCount() const { return _modeCount; }
+  const char*            getModeName(const uint8_t i) const { return _modes[i].name; }
+  const SolarGainTotals& getModeTotals(const uint8_t i) const { return _modes[i].totals; }
+  bool                   usesCollector() const { return _collector; }
+
+private:
+  struct ModeTotals {
+    char            name[MODE_SIZE];
+    SolarGainTotals totals;
+  };
+
+  uint32_t _volumeFactor;  // in mWh per centi-degree of the pool
+  uint32_t _flowFactor;    // in mWh per centi-degree and hour
+
+  bool          _started;  // previous values are set
+  bool          _collector;
+  unsigned long _lastSample;  // millis()
+  int16_t       _lastPool;
+  bool          _lastPumpOn;
+  uint32_t      _lastPumpTime;
+  uint32_t      _lastCycles;
+  uint16_t      _day;
+  int32_t       _remainder;  // in mWh, not yet added to the totals
+
+  SolarGainTotals _today;
+  ModeTotals      _modes[MAX_MODES];
+  uint8_t         _modeCount;
+
+  SolarGainTotals* findMode(const char* mode);
+  void             add(SolarGainTotals* totals, const int64_t energy, const uint32_t pumpTime, const uint32_t cycles);
+};
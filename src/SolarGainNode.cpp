@@ -0,0 +1,136 @@
+/**
+ * Homie Node publishing the heat gained by the solar heating.
+ *
+ */
+
+#include "SolarGainNode.hpp"
+#include "Timer.hpp"
+
+const char SolarGainNode::cCaption[] PROGMEM = "• Solar Gain:";
+
+const char SolarGainNode::cEnergyToday[]     = "energy-today";
+const char SolarGainNode::cEnergyTodayName[] = "Heat Gained Today";
+const char SolarGainNode::cPerPumpHour[]     = "per-pump-hour";
+const char SolarGainNode::cPerPumpHourName[] = "Heat per Pump Hour";
+const char SolarGainNode::cPerCycle[]        = "per-cycle";
+const char SolarGainNode::cPerCycleName[]    = "Heat per Pump Start";
+const char SolarGainNode::cByMode[]          = "by-mode";
+const char SolarGainNode::cByModeName[]      = "Heat by Operation Mode";
+
+/**
+ *
+ */
+SolarGainNode::SolarGainNode(const char* id, const char* name, const int publishInterval)
+    : HomieNode(id, name, "solar-gain") {
+
+  _publishInterval     = (publishInterval > MIN_INTERVAL) ? publishInterval : MIN_INTERVAL;
+  _lastPublish         = 0;
+  _sampleTask          = DeadlineScheduler::INVALID_TASK;
+  _poolTemperatureNode = nullptr;
+  _inletNode           = nullptr;
+  _outletNode          = nullptr;
+  _solarPumpNode       = nullptr;
+  _operationModeNode   = nullptr;
+}
+
+/**
+ * Probes at the inlet and outlet of the collector, nullptr if there are none.
+ */
+void SolarGainNode::setCollectorNodes(DallasTemperatureNode* inlet, DallasTemperatureNode* outlet) {
+  _inletNode  = inlet;
+  _outletNode = outlet;
+}
+
+/**
+ *
+ */
+void SolarGainNode::setPublishInterval(unsigned long interval) {
+  _publishInterval = (interval > MIN_INTERVAL) ? interval : MIN_INTERVAL;
+}
+
+/**
+ *
+ */
+void SolarGainNode::setup() {
+  printCaption();
+
+  advertise(cEnergyToday).setName(cEnergyTodayName).setDatatype("float").setUnit("kWh");
+  advertise(cPerPumpHour).setName(cPerPumpHourName).setDatatype("float").setUnit("kWh/h");
+  advertise(cPerCycle).setName(cPerCycleName).setDatatype("float").setUnit("kWh");
+  advertise(cByMode).setName(cByModeName).setDatatype("string");
+
+  // sampling and publishing share one task
+  _sampleTask = scheduler.addPeriodic(getId(), sampleTask, this, SAMPLE_INTERVAL, SAMPLE_INTERVAL);
+}
+
+/**
+ *
+ */
+void SolarGainNode::onReadyToOperate() {
+  // publish the next sample
+  _lastPublish = millis() - _publishInterval * 1000UL;
+}
+
+/**
+ * Feed the estimator with the latest temperatures and pump counters.
+ */
+void SolarGainNode::sample() {
+  if (_poolTemperatureNode == nullptr || _solarPumpNode == nullptr || _operationModeNode == nullptr ||
+      !_gain.isConfigured()) {
+    return;
+  }
+
+  const RelayStatistics& statistics = _solarPumpNode->getStatistics();
+  const ControlSettings  settings   = _operationModeNode->getSettings();
+  const int16_t          inlet      = (_inletNode != nullptr) ? _inletNode->getTemperature() : TEMPERATURE_INVALID;
+  const int16_t          outlet     = (_outletNode != nullptr) ? _outletNode->getTemperature() : TEMPERATURE_INVALID;
+
+  _gain.sample(millis(), _poolTemperatureNode->getTemperature(), inlet, outlet, _solarPumpNode->getSwitch(),
+               statistics.onTimeTotal, statistics.cycles, settings.mode, getCurrentDay());
+
+  if (millis() - _lastPublish >= _publishInterval * 1000UL) {
+    _lastPublish = millis();
+    publish();
+  }
+}
+
+/**
+ * Totals of the day and, since boot, per operation mode as JSON:
+ * {"<mode>":{"energy":kWh,"hours":h,"cycles":n},...}
+ */
+void SolarGainNode::publish() {
+  if (!Homie.isConnected()) {
+    return;
+  }
+
+  const SolarGainTotals& today = _gain.getToday();
+  Homie.getLogger() << F("〽 Sending Solar Gain: ") << getId() << F(" (") << (_gain.usesCollector() ? F("collector") : F("pool"))
+                    << F(")") << endl;
+
+  setProperty(cEnergyToday).send(String(today.energy / 1000.0, 3));
+  setProperty(cPerPumpHour).send(String(today.getEnergyPerPumpHour(), 3));
+  setProperty(cPerCycle).send(String(today.getEnergyPerCycle(), 3));
+
+  char   buffer[BUFFER_SIZE];
+  size_t length = snprintf(buffer, BUFFER_SIZE, "{");
+  for (uint8_t i = 0; i < _gain.getModeCount() && length < BUFFER_SIZE; i++) {
+    const SolarGainTotals& totals = _gain.getModeTotals(i);
+    const unsigned long    energy = labs(totals.energy);  // in Wh
+    length += snprintf(buffer + length, BUFFER_SIZE - length,
+                       "%s\"%s\":{\"energy\":%s%lu.%03lu,\"hours\":%lu.%02lu,\"cycles\":%lu}", (i > 0) ? "," : "",
+                       _gain.getModeName(i), (totals.energy < 0) ? "-" : "", energy / 1000, energy % 1000,
+                       (unsigned long)(totals.pumpTime / 3600), (unsigned long)(totals.pumpTime % 3600 / 36),
+                       (unsigned long)totals.cycles);
+  }
+  if (length + 1 < BUFFER_SIZE) {
+    strcpy(buffer + length, "}");
+    setProperty(cByMode).send(buffer);
+  }
+}
+
+/**
+ *
+ */
+void SolarGainNode::printCaption() {
+  Homie.getLogger() << FPSTR(cCaption) << endl;
+}
@@ -0,0 +1,70 @@
+/**
+ * Homie Node publishing the heat gained by the solar heating, see SolarGain.
+ *
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include "SolarGain.hpp"
+#include "DallasTemperatureNode.hpp"
+#include "RelayModuleNode.hpp"
+#include "OperationModeNode.hpp"
+#include "DeadlineScheduler.hpp"
+#include "NodeStrings.hpp"
+
+class SolarGainNode : public HomieNode {
+
+public:
+  SolarGainNode(const char* id, const char* name, const int publishInterval = PUBLISH_INTERVAL);
+
+  void setPoolTemperatureNode(DallasTemperatureNode* node) { _poolTemperatureNode = node; }
+  void setCollectorNodes(DallasTemperatureNode* inlet, DallasTemperatureNode* outlet);
+  void setSolarPumpNode(RelayModuleNode* node) { _solarPumpNode = node; }
+  void setOperationModeNode(OperationModeNode* node) { _operationModeNode = node; }
+
+  void          setPoolVolume(const float volume) { _gain.setPoolVolume(volume); }
+  void          setFlow(const float flow) { _gain.setFlow(flow); }
+  void          setPublishInterval(unsigned long interval);
+  unsigned long getPublishInterval() const { return _publishInterval; }
+
+  const SolarGain& getGain() const { return _gain; }
+
+protected:
+  void setup() override;
+  void onReadyToOperate() override;
+
+private:
+  static const int           MIN_INTERVAL     = 60;  // in seconds
+  static const int           PUBLISH_INTERVAL = 300;
+  static const unsigned long SAMPLE_INTERVAL  = 30000;  // in ms
+  static const size_t        BUFFER_SIZE      = 320;
+
+  static const char cCaption[];
+
+  static const char cEnergyToday[];
+  static const char cEnergyTodayName[];
+  static const char cPerPumpHour[];
+  static const char cPerPumpHourName[];
+  static const char cPerCycle[];
+  static const char cPerCycleName[];
+  static const char cByMode[];
+  static const char cByModeName[];
+
+  unsigned long _publishInterval;  // in s
+  unsigned long _lastPublish;      // millis()
+  int8_t        _sampleTask;
+
+  DallasTemperatureNode* _poolTemperatureNode;
+  DallasTemperatureNode* _inletNode;
+  DallasTemperatureNode* _outletNode;
+  RelayModuleNode*       _solarPumpNode;
+  OperationModeNode*     _operationModeNode;
+
+  SolarGain _gain;
+
+  void        sample();
+  static void sampleTask(void* node) { static_cast<SolarGainNode*>(node)->sample(); }
+  void        publish();
+  void        printCaption();
+};
@@ -0,0 +1,57 @@
+/**
+ * Lock-free ring buffer for one producer and one consumer.
+ *
+ * The producer only writes _head, the consumer only writes _tail; the
+ * release/acquire pairs make the item visible before the index that
+ * publishes it. Safe between two FreeRTOS tasks on different cores without
+ * a mutex. Indexes run freely and wrap at 256, so CAPACITY must be a power
+ * of two up to 128.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+template <typename T, uint8_t CAPACITY>
+class SpscRing {
+  static_assert(CAPACITY > 0 && CAPACITY <= 128 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+  SpscRing() : _head(0), _tail(0) {}
+
+  /**
+   * Producer side. False if the ring is full.
+   */
+  bool push(const T& item) {
+    const uint8_t head = _head.load(std::memory_order_relaxed);
+    const uint8_t tail = _tail.load(std::memory_order_acquire);
+    if ((uint8_t)(head - tail) == CAPACITY) {
+      return false;
+    }
+
+    _items[head & (CAPACITY - 1)] = item;
+    _head.store((uint8_t)(head + 1), std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side. False if the ring is empty.
+   */
+  bool pop(T& item) {
+    const uint8_t tail = _tail.load(std::memory_order_relaxed);
+    const uint8_t head = _head.load(std::memory_order_acquire);
+    if (head == tail) {
+      return false;
+    }
+
+    item = _items[tail & (CAPACITY - 1)];
+    _tail.store((uint8_t)(tail + 1), std::memory_order_release);
+    return true;
+  }
+
+private:
+  T                    _items[CAPACITY];
+  std::atomic<uint8_t> _head;  // next slot to write
+  std::atomic<uint8_t> _tail;  // next slot to read
+};
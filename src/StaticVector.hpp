@@ -0,0 +1,45 @@
+/**
+ * Vector with a fixed capacity in place, no heap allocation.
+ *
+ * The memory footprint is known at compile time; push_back() fails instead
+ * of growing when the vector is full.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+template <typename T, uint8_t CAPACITY>
+class StaticVector {
+
+public:
+  StaticVector() : _size(0) {}
+
+  static constexpr uint8_t capacity() { return CAPACITY; }
+
+  uint8_t size() const { return _size; }
+  bool    empty() const { return _size == 0; }
+  bool    full() const { return _size == CAPACITY; }
+
+  bool push_back(const T& item) {
+    if (full()) {
+      return false;
+    }
+    _items[_size++] = item;
+    return true;
+  }
+
+  void clear() { _size = 0; }
+
+  T&       operator[](const uint8_t index) { return _items[index]; }
+  const T& operator[](const uint8_t index) const { return _items[index]; }
+
+  T*       begin() { return _items; }
+  T*       end() { return _items + _size; }
+  const T* begin() const { return _items; }
+  const T* end() const { return _items + _size; }
+
+private:
+  T       _items[CAPACITY];
+  uint8_t _size;
+};
@@ -0,0 +1,111 @@
+/**
+ * Homie Node receiving the electricity prices of today and the day ahead.
+ *
+ */
+
+#include "TariffNode.hpp"
+
+const char TariffNode::cCaption[] PROGMEM = "• Tariff:";
+
+const char TariffNode::cPrices[]     = "prices";
+const char TariffNode::cPricesName[] = "Electricity Prices (JSON)";
+
+/**
+ *
+ */
+TariffNode::TariffNode(const char* id, const char* name) : HomieNode(id, name, "tariff") {
+  _planner = nullptr;
+#if LOOP_PROFILER
+  _inputProfile = LoopProfiler::INVALID_SLOT;
+#endif
+}
+
+/**
+ *
+ */
+void TariffNode::setup() {
+  advertise(cHomieNodeState).setName(cHomieNodeStateName);
+  advertise(cPrices).setName(cPricesName).setDatatype("string").settable();
+#if LOOP_PROFILER
+  _inputProfile = loopProfiler.addSlot(getId(), "input");
+#endif
+}
+
+/**
+ *
+ */
+bool TariffNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+  PROFILE_SCOPE(_inputProfile);
+  printCaption();
+
+  Homie.getLogger() << FPSTR(cIndent) << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
+  if (!property.equalsIgnoreCase(cPrices)) {
+    return false;
+  }
+
+  char       summary[SUMMARY_SIZE];
+  const bool retval = updatePrices(value.c_str(), summary);
+  if (Homie.isConnected()) {
+    setProperty(cHomieNodeState).send(retval ? cHomieNodeState_OK : cHomieNodeState_Error);
+    if (retval) {
+      // a summary instead of the whole payload
+      setProperty(cPrices).send(summary);
+    }
+  }
+  return retval;
+}
+
+/**
+ * Hand the prices of a day to the planner; the rule picks them up with its next evaluation.
+ * On success summary (SUMMARY_SIZE) holds date and number of prices as JSON.
+ */
+bool TariffNode::updatePrices(const char* json, char* summary) {
+  if (_planner == nullptr) {
+    return false;
+  }
+
+  StaticJsonDocument<DOCUMENT_SIZE> document;
+  const DeserializationError        error = deserializeJson(document, json);
+  if (error) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ prices: ") << error.c_str() << endl;
+    return false;
+  }
+
+  int         year  = 0;
+  int         month = 0;
+  int         day   = 0;
+  const char* date  = document["date"] | "";
+  if (sscanf(date, "%4d-%2d-%2d", &year, &month, &day) != 3 || getDayOf(year, month, day) == 0) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ prices: invalid date '") << date << F("'") << endl;
+    return false;
+  }
+
+  JsonArray values = document["prices"].as<JsonArray>();
+  int16_t   prices[FiltrationPlanner::SLOTS];
+  uint8_t   count = 0;
+  for (JsonVariant value : values) {
+    const float price = value.as<float>();
+    if (!value.is<float>() || count >= FiltrationPlanner::SLOTS || price < -327.0f || price > 327.0f) {
+      Homie.getLogger() << FPSTR(cIndent) << F("✖ prices: expected up to 48 numbers within +-327") << endl;
+      return false;
+    }
+    prices[count++] = (int16_t)(price * 100.0f + ((price < 0) ? -0.5f : 0.5f));
+  }
+
+  if ((count != 24 && count != FiltrationPlanner::SLOTS) || !_planner->setPrices(getDayOf(year, month, day), prices, count)) {
+    Homie.getLogger() << FPSTR(cIndent) << F("✖ prices: ") << count << F(" prices for ") << date
+                      << F(", expected 24 or 48 for today or tomorrow") << endl;
+    return false;
+  }
+
+  Homie.getLogger() << FPSTR(cIndent) << F("✔ prices: ") << count << F(" prices for ") << date << endl;
+  snprintf(summary, SUMMARY_SIZE, "{\"date\":\"%04d-%02d-%02d\",\"count\":%u}", year, month, day, count);
+  return true;
+}
+
+/**
+ *
+ */
+void TariffNode::printCaption() {
+  Homie.getLogger() << FPSTR(cCaption) << endl;
+}
@@ -0,0 +1,49 @@
+/**
+ * Homie Node receiving the electricity prices of today and the day ahead.
+ *
+ * Property "prices" takes a JSON object with the local date and 24 hourly or
+ * 48 half-hourly prices, e.g. {"date":"2026-10-20","prices":[28.1,27.4,...]},
+ * in ct/kWh or any other unit up to +-327. FiltrationPlanner plans the pool
+ * pump of rule filter into the cheapest slots from them. Accepted prices are
+ * acknowledged with date and count, e.g. {"date":"2026-10-20","count":48}.
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include <ArduinoJson.h>
+#include "FiltrationPlanner.hpp"
+#include "Timer.hpp"
+#include "LoopProfiler.hpp"
+#include "NodeStrings.hpp"
+
+class TariffNode : public HomieNode {
+
+public:
+  TariffNode(const char* id, const char* name);
+
+  static const size_t SUMMARY_SIZE = 40;
+
+  void setPlanner(FiltrationPlanner* planner) { _planner = planner; }
+  bool updatePrices(const char* json, char* summary);
+
+protected:
+  void setup() override;
+  bool handleInput(const HomieRange& range, const String& property, const String& value) override;
+
+private:
+  // the strings are copied from the input: both keys and the date take 23 bytes
+  static const size_t DOCUMENT_SIZE = JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(FiltrationPlanner::SLOTS) + 32;
+
+  static const char cCaption[];
+
+  static const char cPrices[];
+  static const char cPricesName[];
+
+  FiltrationPlanner* _planner;
+#if LOOP_PROFILER
+  int8_t _inputProfile;
+#endif
+
+  void printCaption();
+};
@@ -0,0 +1,194 @@
+/**
+ * Fixed-point temperatures: int16_t in centi-degrees Celsius (28.5 °C is 2850).
+ *
+ * The ESP8266 has no FPU, so sensors, settings and rules work with these
+ * integers; floats only appear where a value is published. Hysteresis
+ * thresholds are derived from the settings once, when a setting changes.
+ *
+ * Plain C++ without Arduino dependencies, so it also builds on the host
+ * (see bench/).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const int16_t TEMPERATURE_INVALID = INT16_MIN;  // no valid reading
+static const int16_t TEMPERATURE_MAX     = INT16_MAX;
+
+/**
+ * Quotient rounded half away from zero.
+ */
+constexpr int32_t divRound(const int32_t a, const int32_t b) {
+  return (a >= 0) ? (a + b / 2) / b : (a - b / 2) / b;
+}
+
+/**
+ * DS18B20 raw value (1/128 °C, as returned by DallasTemperature::getTemp()) to centi-degrees.
+ */
+constexpr int16_t centiFromRaw(const int32_t raw) {
+  return (int16_t)divRound(raw * 25, 32);
+}
+
+/**
+ * Degrees Fahrenheit to centi-degrees.
+ */
+constexpr int16_t centiFromFahrenheit(const int32_t fahrenheit) {
+  return (int16_t)divRound((fahrenheit - 32) * 500, 9);
+}
+
+/**
+ * Whole degrees to centi-degrees.
+ */
+constexpr int16_t centiFromDegrees(const int32_t degrees) {
+  return (int16_t)(degrees * 100);
+}
+
+/**
+ * Degrees from a configuration value; only for settings, not in the control loop.
+ */
+constexpr int16_t centiFromCelsius(const double celsius) {
+  return (int16_t)(celsius * 100 + ((celsius < 0) ? -0.5 : 0.5));
+}
+
+/**
+ * Settings of the rules and the thresholds derived from them.
+ */
+struct TemperatureThresholds {
+  // settings
+  int16_t poolMax;
+  int16_t solarMin;
+  int16_t hysteresis;
+
+  // derived
+  int16_t poolMaxOff;   // poolMax + hysteresis: stop heating
+  int16_t poolMaxOn;    // poolMax - hysteresis: boost starts heating below
+  int16_t solarMinOff;  // solarMin - hysteresis: solar too cold
+};
+
+constexpr TemperatureThresholds makeThresholds(const int16_t poolMax, const int16_t solarMin, const int16_t hysteresis) {
+  return TemperatureThresholds{poolMax,
+                               solarMin,
+                               hysteresis,
+                               (int16_t)(poolMax + hysteresis),
+                               (int16_t)(poolMax - hysteresis),
+                               (int16_t)(solarMin - hysteresis)};
+}
+
+/**
+ * Parse a decimal number like "28.5" or "-3.25" into centi-degrees, rounding
+ * further decimals. False (value unchanged) on anything else or out of range.
+ */
+inline bool parseCentiDegrees(const char* text, int16_t& value) {
+  if (text == NULL) {
+    return false;
+  }
+  while (*text == ' ') {
+    text++;
+  }
+
+  const bool negative = (*text == '-');
+  if (*text == '-' || *text == '+') {
+    text++;
+  }
+
+  int32_t result   = 0;
+  uint8_t digits   = 0;
+  int8_t  decimals = -1;  // -1 before the decimal point
+  for (; *text != '\0' && *text != ' '; text++) {
+    if (*text == '.' && decimals < 0) {
+      decimals = 0;
+    } else if (*text >= '0' && *text <= '9') {
+      digits++;
+      if (decimals < 0) {
+        result = result * 10 + (*text - '0');
+        if (result > 1000) {
+          return false;
+        }
+      } else if (decimals < 2) {
+        result = result * 10 + (*text - '0');
+        decimals++;
+      } else if (decimals == 2) {
+        // round on the third decimal, ignore the rest
+        result += (*text >= '5') ? 1 : 0;
+        decimals++;
+      }
+    } else {
+      return false;
+    }
+  }
+  while (*text == ' ') {
+    text++;
+  }
+  if (digits == 0 || *text != '\0') {
+    return false;
+  }
+
+  for (int8_t i = (decimals < 0) ? 0 : decimals; i < 2; i++) {
+    result *= 10;
+  }
+  if (result > TEMPERATURE_MAX) {
+    return false;
+  }
+
+  value = (int16_t)(negative ? -result : result);
+  return true;
+}
+
+/**
+ * Write the value with two decimals ("28.50"), "nan" if invalid. buffer needs
+ * 8 bytes; returns the length.
+ */
+inline size_t formatCentiDegrees(const int16_t value, char* buffer) {
+  if (value == TEMPERATURE_INVALID) {
+    buffer[0] = 'n';
+    buffer[1] = 'a';
+    buffer[2] = 'n';
+    buffer[3] = '\0';
+    return 3;
+  }
+
+  char     digits[8];
+  uint8_t  count     = 0;
+  uint16_t magnitude = (value < 0) ? -(int32_t)value : value;
+  do {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude > 0 || count < 3);
+
+  size_t length = 0;
+  if (value < 0) {
+    buffer[length++] = '-';
+  }
+  while (count > 2) {
+    buffer[length++] = digits[--count];
+  }
+  buffer[length++] = '.';
+  buffer[length++] = digits[1];
+  buffer[length++] = digits[0];
+  buffer[length]   = '\0';
+  return length;
+}
+
+#ifdef ARDUINO
+#include <Print.h>
+
+/**
+ * Print a centi-degree value with Homie.getLogger() << CentiDegrees(value).
+ */
+class CentiDegrees : public Printable {
+
+public:
+  explicit CentiDegrees(const int16_t value) : _value(value) {}
+
+  size_t printTo(Print& p) const override {
+    char buffer[8];
+    formatCentiDegrees(_value, buffer);
+    return p.print(buffer);
+  }
+
+private:
+  int16_t _value;
+};
+#endif
@@ -7,9 +7,17 @@
 // NTP Client
 const char *TC_SERVER = "europe.pool.ntp.org";
 
+const unsigned long TC_SYNC_INTERVAL  = 60 * 60 * 1000UL; // resync once an hour
+const unsigned long TC_RETRY_INTERVAL = 30 * 1000UL;      // after a failed sync
+
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, TC_SERVER);
 
+bool          _ntpStarted  = false;
+bool          _timeSynced  = false;
+unsigned long _lastSync    = 0;
+unsigned long _lastSyncTry = 0;
+
 // For starters use hardwired Central European Time (Berlin, Paris, ...)
 TimeChangeRule CEST = {"CEST", Last, Sun, Mar, 2, 120}; // Central European Summer Time
 TimeChangeRule CET = {"CET ", Last, Sun, Oct, 3, 60};   // Central European Standard Time
@@ -27,6 +35,7 @@ TimeZoneInfo _timezones[2] = {
 void timeClientSetup() {
   // initialize NTP Client
   timeClient.begin();
+  _ntpStarted = true;
 
   // Set callback for time library and leave the sync to the NTP client
   setSyncProvider(getUtcTime);
@@ -37,12 +46,42 @@ int getTzCount() {
   return (sizeof(_timezones) / sizeof(_timezones[0]));
 }
 
+/**
+ * UTC time, 0 while the time has never been synced.
+ *
+ * A sync waits up to 1 s for the NTP server, so it is only tried while WiFi is
+ * connected and at most every TC_RETRY_INTERVAL. Between syncs, and without
+ * network, the time runs on from the last sync.
+ */
 time_t getUtcTime() {
-  if (timeClient.update()) {
-    return timeClient.getEpochTime();
-  }   else {
-    return 0;
+  const unsigned long now = millis();
+  const bool due = !_timeSynced || (now - _lastSync >= TC_SYNC_INTERVAL);
+
+  if (due && WiFi.status() == WL_CONNECTED && (_lastSyncTry == 0 || now - _lastSyncTry >= TC_RETRY_INTERVAL)) {
+    if (!_ntpStarted) {
+      timeClient.begin();
+      _ntpStarted = true;
+    }
+    _lastSyncTry = now;
+    if (timeClient.forceUpdate()) {
+      _timeSynced = true;
+      _lastSync   = now;
+    }
   }
+
+  return _timeSynced ? timeClient.getEpochTime() : 0;
+}
+
+bool isTimeKnown() {
+  getUtcTime();
+  return _timeSynced;
+}
+
+/**
+ * Seconds since the last successful NTP sync, -1 before the first one.
+ */
+long getSyncAge() {
+  return _timeSynced ? (long)((millis() - _lastSync) / 1000) : -1;
 }
 
 time_t getTimeFor(int index, TimeChangeRule **tcr) {
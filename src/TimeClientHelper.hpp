@@ -8,6 +8,11 @@
 #include "Timezone.h"
 #include <WiFiUdp.h>
 #include <NTPClient.h>
+#ifdef ESP32
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#endif
 
 struct TimeZoneInfo
 {
@@ -18,6 +23,8 @@ struct TimeZoneInfo
 void timeClientSetup();
 int getTzCount();
 time_t getUtcTime();
+bool isTimeKnown();
+long getSyncAge();
 time_t getTimeFor(int index, TimeChangeRule **tcr);
 String getTimeInfoFor(int index);
 String getFormattedTime(time_t rawTime);
@@ -30,4 +30,34 @@ tm getEndTime(TimerSetting timerSetting) {
   return endTime;
 }
 
+/**
+ * Index of the current local day, changes at local midnight.
+ * 0 if the time is not known yet.
+ */
+uint16_t getCurrentDay() {
+  tm time = getCurrentDateTime();
+  if (time.tm_year < 100) {
+    return 0;
+  }
+
+  return (time.tm_year - 100) * 366 + time.tm_yday + 1;
+}
 
+/**
+ * Index of a local date like getCurrentDay(), 0 for an invalid date or one before 2000.
+ */
+uint16_t getDayOf(const int year, const int month, const int day) {
+  static const uint16_t daysBefore[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  static const uint8_t  daysIn[]     = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  if (year < 2000 || year > 2099 || month < 1 || month > 12 || day < 1 || day > daysIn[month - 1]) {
+    return 0;
+  }
+
+  const bool leap = (year % 4 == 0);  // 2000 is a leap year as well
+  if (!leap && month == 2 && day == 29) {
+    return 0;
+  }
+  const uint16_t yday = daysBefore[month - 1] + ((leap && month > 2) ? 1 : 0) + day - 1;
+  return (year - 2000) * 366 + yday + 1;
+}
@@ -12,3 +12,5 @@ struct TimerSetting {
 tm getCurrentDateTime();
 tm getStartTime(TimerSetting ts);
 tm getEndTime(TimerSetting ts);
+uint16_t getCurrentDay();
+uint16_t getDayOf(const int year, const int month, const int day);
@@ -0,0 +1,105 @@
+/**
+ * Hardware topology: which sensors and relays are connected and what they are used for.
+ *
+ * A site header (default SiteDefault.hpp, another one with build flag
+ * SITE_TOPOLOGY) describes the hardware in two constexpr tables, SENSORS and
+ * RELAYS. main.cpp instantiates one node per table entry as a static
+ * NodeArray and looks up the nodes the rules need by their role at compile
+ * time. Nothing is allocated on the heap, there is no lookup at runtime.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "IndexSequence.hpp"
+
+/**
+ * What the rules use a node for. Nodes with ROLE_NONE are only published.
+ * The collector probes are optional, see SolarGain.
+ */
+enum NodeRole : uint8_t {
+  ROLE_NONE,
+  ROLE_POOL_TEMPERATURE,
+  ROLE_SOLAR_TEMPERATURE,
+  ROLE_POOL_PUMP,
+  ROLE_SOLAR_PUMP,
+  ROLE_COLLECTOR_INLET,
+  ROLE_COLLECTOR_OUTLET,
+};
+
+/**
+ * DS18B20 sensor on its own 1-Wire bus.
+ */
+struct SensorSpec {
+  const char* id;
+  const char* name;
+  uint8_t     pin;  // 1-Wire bus
+  NodeRole    role;
+};
+
+/**
+ * Relay switching a pump.
+ */
+struct RelaySpec {
+  const char* id;
+  const char* name;
+  uint8_t     pin;
+  NodeRole    role;
+};
+
+/**
+ * Index of the first entry with the role, -1 if there is none.
+ */
+template <typename Spec, size_t N>
+constexpr int8_t findRole(const Spec (&specs)[N], const NodeRole role, const size_t i = 0) {
+  return (i >= N) ? -1 : (specs[i].role == role) ? (int8_t)i : findRole(specs, role, i + 1);
+}
+
+/**
+ * Number of entries with the role.
+ */
+template <typename Spec, size_t N>
+constexpr uint8_t countRole(const Spec (&specs)[N], const NodeRole role, const size_t i = 0) {
+  return (i >= N) ? 0 : (specs[i].role == role) + countRole(specs, role, i + 1);
+}
+
+/**
+ * One node per entry of a topology table, constructed in place.
+ *
+ * Each node gets id, name and pin of its entry followed by the extra
+ * constructor arguments. The nodes are never copied: HomieNode registers
+ * itself by address in its constructor.
+ */
+template <typename Node, size_t N>
+class NodeArray {
+
+public:
+  template <typename Spec, typename... Args>
+  NodeArray(const Spec (&specs)[N], Args... args) : NodeArray(typename MakeIndexSequence<N>::type(), specs, args...) {}
+
+  Node&  operator[](const size_t i) { return _nodes[i]; }
+  size_t size() const { return N; }
+  Node*  begin() { return _nodes; }
+  Node*  end() { return _nodes + N; }
+
+private:
+  template <size_t... I, typename Spec, typename... Args>
+  NodeArray(IndexSequence<I...>, const Spec (&specs)[N], Args... args)
+      : _nodes{{specs[I].id, specs[I].name, specs[I].pin, args...}...} {}
+
+  Node _nodes[N];
+};
+
+#ifdef SITE_TOPOLOGY
+#include SITE_TOPOLOGY
+#else
+#include "SiteDefault.hpp"
+#endif
+
+static_assert(countRole(SENSORS, ROLE_POOL_TEMPERATURE) == 1, "the site needs exactly one pool temperature sensor");
+static_assert(countRole(SENSORS, ROLE_SOLAR_TEMPERATURE) == 1, "the site needs exactly one solar temperature sensor");
+static_assert(countRole(RELAYS, ROLE_POOL_PUMP) == 1, "the site needs exactly one pool pump");
+static_assert(countRole(RELAYS, ROLE_SOLAR_PUMP) == 1, "the site needs exactly one solar pump");
+static_assert(countRole(SENSORS, ROLE_COLLECTOR_INLET) <= 1 &&
+                  countRole(SENSORS, ROLE_COLLECTOR_INLET) == countRole(SENSORS, ROLE_COLLECTOR_OUTLET),
+              "the collector needs one inlet and one outlet sensor, or none");
@@ -10,31 +10,32 @@
 #include "DallasTemperatureNode.hpp"
 #include "ESP32TemperatureNode.hpp"
 #include "RelayModuleNode.hpp"
+#include "RelayStateStore.hpp"
+#include "RelaySequencer.hpp"
+#include "SettingsStore.hpp"
 #include "OperationModeNode.hpp"
+#include "DiagnosticsNode.hpp"
+#include "SolarGainNode.hpp"
+#include "TariffNode.hpp"
+#include "DeadlineScheduler.hpp"
+#include "PowerManager.hpp"
+#include "LoopProfiler.hpp"
+#include "HeapMonitor.hpp"
+#include "BootProfile.hpp"
 #include "Rule.hpp"
 #include "RuleManu.hpp"
 #include "RuleAuto.hpp"
 #include "RuleBoost.hpp"
 #include "RuleTimer.hpp"
+#include "RuleFiltration.hpp"
+#include "RulePredictive.hpp"
+#include "Topology.hpp"
+#include "HttpApi.hpp"
+#include "History.hpp"
 
 #include "LoggerNode.hpp"
 #include "TimeClientHelper.hpp"
 
-#ifdef ESP32
-const uint8_t PIN_DS_SOLAR = 15;  // Pin of Temp-Sensor Solar
-const uint8_t PIN_DS_POOL  = 16;  // Pin of Temp-Sensor Pool
-
-const uint8_t PIN_RELAY_POOL  = 18;
-const uint8_t PIN_RELAY_SOLAR = 19;
-#elif defined(ESP8266)
-
-// see: https://randomnerdtutorials.com/esp8266-pinout-reference-gpios/
-const uint8_t PIN_DS_SOLAR = D5;  // Pin of Temp-Sensor Solar
-const uint8_t PIN_DS_POOL  = D6;  // Pin of Temp-Sensor Pool
-
-const uint8_t PIN_RELAY_POOL  = D1;
-const uint8_t PIN_RELAY_SOLAR = D2;
-#endif
 const uint8_t TEMP_READ_INTERVALL = 30;  //Sekunden zwischen Updates der Temperaturen.
 
 HomieSetting<long> loopIntervalSetting("loop-interval", "The processing interval in seconds");
@@ -44,81 +45,251 @@ HomieSetting<double> temperatureMinSolarSetting("temperature-min-solar", "Minimu
 HomieSetting<double> temperatureHysteresisSetting("temperature-hysteresis", "Temperature hysteresis");
 
 HomieSetting<const char*> operationModeSetting("operation-mode", "Operational Mode");
+HomieSetting<long>        diagnosticsIntervalSetting("diagnostics-interval", "Publish interval of the diagnostics in minutes");
+HomieSetting<long>        heapRestartSetting("heap-restart-block",
+                                             "Restart when the largest free heap block stays below this size in bytes, "
+                                             "0 disables");
+HomieSetting<const char*> powerModeSetting("power-mode", "Power saving between tasks: off, modem or light");
+HomieSetting<long>        httpPortSetting("http-port", "Port of the local HTTP API, 0 disables");
+
+HomieSetting<double> poolVolumeSetting("pool-volume", "Water volume of the pool in m³");
+HomieSetting<double> pumpFlowSetting("pump-flow", "Flow rate of the pool pump in m³/h");
+HomieSetting<long>   filterMinRunSetting("filter-min-run", "Minimum runtime of the pool pump in rule filter in minutes");
+HomieSetting<long>   predictHorizonSetting("predict-horizon", "Prediction horizon of rule predict in minutes");
+
+HomieSetting<long> relayMinOnTimeSetting("relay-min-on", "Minimum on time of the pumps in seconds");
+HomieSetting<long> relayMinOffTimeSetting("relay-min-off", "Minimum off time of the pumps in seconds");
+HomieSetting<long> relayStaggerSetting("relay-stagger", "Delay between two pump starts in seconds");
+HomieSetting<long> poolPumpPowerSetting("pool-pump-power", "Electrical power of the pool pump in W");
+HomieSetting<long> solarPumpPowerSetting("solar-pump-power", "Electrical power of the solar pump in W");
+HomieSetting<long> solarPumpDelaySetting("solar-pump-delay",
+                                         "Runtime of the pool pump before the solar pump may start in seconds");
 
 LoggerNode LN;
 
-DallasTemperatureNode solarTemperatureNode("solar-temp", "Solar Temperature", PIN_DS_SOLAR, TEMP_READ_INTERVALL);
-DallasTemperatureNode poolTemperatureNode("pool-temp", "Pool Temperature", PIN_DS_POOL, TEMP_READ_INTERVALL);
+// one node per entry of the site topology, see Topology.hpp
+const size_t SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+const size_t RELAY_COUNT  = sizeof(RELAYS) / sizeof(RELAYS[0]);
+static_assert(RELAY_COUNT <= RelayStateStore::MAX_RELAYS && RELAY_COUNT <= RelaySequencer::MAX_RELAYS, "too many relays");
+#if SENSOR_TASK
+static_assert(SENSOR_COUNT <= SensorTask::MAX_SENSORS, "too many sensors for the sensor task");
+#endif
+
+NodeArray<DallasTemperatureNode, SENSOR_COUNT> temperatureNodes(SENSORS, TEMP_READ_INTERVALL);
+NodeArray<RelayModuleNode, RELAY_COUNT>        relayNodes(RELAYS);
+
+DallasTemperatureNode& solarTemperatureNode = temperatureNodes[findRole(SENSORS, ROLE_SOLAR_TEMPERATURE)];
+DallasTemperatureNode& poolTemperatureNode  = temperatureNodes[findRole(SENSORS, ROLE_POOL_TEMPERATURE)];
+RelayModuleNode&       poolPumpNode         = relayNodes[findRole(RELAYS, ROLE_POOL_PUMP)];
+RelayModuleNode&       solarPumpNode        = relayNodes[findRole(RELAYS, ROLE_SOLAR_PUMP)];
+
+// optional probes of the solar collector, -1 if there are none
+const int8_t COLLECTOR_INLET  = findRole(SENSORS, ROLE_COLLECTOR_INLET);
+const int8_t COLLECTOR_OUTLET = findRole(SENSORS, ROLE_COLLECTOR_OUTLET);
+
 #ifdef ESP32
 ESP32TemperatureNode ctrlTemperatureNode("controller-temp", "Controller Temperature", TEMP_READ_INTERVALL);
 #endif
-RelayModuleNode poolPumpNode("pool-pump", "Pool Pump", PIN_RELAY_POOL);
-RelayModuleNode solarPumpNode("solar-pump", "Solar Pump", PIN_RELAY_SOLAR);
 
 OperationModeNode operationModeNode("operation-mode", "Operation Mode");
 
-unsigned long _measurementInterval = 10;
-unsigned long _lastMeasurement;
+DiagnosticsNode diagnosticsNode("diagnostics", "Diagnostics");
+
+SolarGainNode solarGainNode("solar-gain", "Solar Gain");
+
+TariffNode tariffNode("tariff", "Electricity Tariff");
+
+RuleAuto       autoRule(&solarPumpNode, &poolPumpNode);
+RuleManu       manuRule;
+RuleBoost      boostRule(&solarPumpNode, &poolPumpNode);
+RuleTimer      timerRule(&solarPumpNode, &poolPumpNode);
+RuleFiltration filterRule(&solarPumpNode, &poolPumpNode);
+RulePredictive predictRule(&solarPumpNode, &poolPumpNode);
+
+// used until the configuration is loaded
+const long DEFAULT_RELAY_STAGGER    = 3;   // in s
+const long DEFAULT_SOLAR_PUMP_DELAY = 30;  // in s
+
+const unsigned long SEQUENCER_INTERVAL = 250;   // in ms
+const unsigned long STORE_INTERVAL     = 1000;  // in ms
+
+#if LOOP_PROFILER
+int8_t homieProfile = LoopProfiler::INVALID_SLOT;
+#endif
 
 /**
- * Homie Setup handler.
- * Only called when wifi and mqtt are connected.
+ * Sample of the temperatures and pumps for the HTTP API.
  */
-void setupHandler() {
+void sampleHistory() {
+  uint8_t relays = 0;
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    relays |= relayNodes[i].getSwitch() ? (1 << i) : 0;
+  }
+  history.add(poolTemperatureNode.getTemperature(), solarTemperatureNode.getTemperature(), relays);
+}
+
+/**
+ * Wire sensors, relays and rules from the persisted settings.
+ * Runs right after Homie.setup(), the control works without WiFi and MQTT.
+ */
+void setupControl() {
 
   // set mesurement intervals
   long _loopInterval = loopIntervalSetting.get();
 
-  solarTemperatureNode.setMeasurementInterval(_loopInterval);
-  poolTemperatureNode.setMeasurementInterval(_loopInterval);
+  for (DallasTemperatureNode& node : temperatureNodes) {
+    node.setMeasurementInterval(_loopInterval);
+  }
+
+  for (RelayModuleNode& node : relayNodes) {
+    node.setMeasurementInterval(_loopInterval);
+
+    // protect the pumps against short cycling
+    node.setMinOnTime(relayMinOnTimeSetting.get());
+    node.setMinOffTime(relayMinOffTimeSetting.get());
+  }
+
+  // energy estimation
+  poolPumpNode.setPower(poolPumpPowerSetting.get());
+  solarPumpNode.setPower(solarPumpPowerSetting.get());
+
+  diagnosticsNode.setPublishInterval(diagnosticsIntervalSetting.get() * 60);
+  heapMonitor.setRestartLimit(heapRestartSetting.get());
 
-  poolPumpNode.setMeasurementInterval(_loopInterval);
-  solarPumpNode.setMeasurementInterval(_loopInterval);
+  // sleep between the tasks, only takes effect while connected
+  powerManager.setMode(powerModeSetting.get());
+
+  // never start both pumps at once, solar pump only runs while pool pump runs
+  relaySequencer.setStaggerDelay(relayStaggerSetting.get());
+  relaySequencer.setDependency(&solarPumpNode, &poolPumpNode, solarPumpDelaySetting.get());
 
 #ifdef ESP32
   ctrlTemperatureNode.setMeasurementInterval(_loopInterval);
 #endif
 
-  operationModeNode.setMode(operationModeSetting.get());
-  operationModeNode.setPoolMaxTemperature(temperatureMaxPoolSetting.get());
-  operationModeNode.setSolarMinTemperature(temperatureMinSolarSetting.get());
-  operationModeNode.setTemperatureHysteresis(temperatureHysteresisSetting.get());
-  TimerSetting ts      = operationModeNode.getTimerSetting();  //TODO: Configurable
-  ts.timerStartHour    = 10;
-  ts.timerStartMinutes = 30;
-  ts.timerEndHour      = 17;
-  ts.timerEndMinutes   = 30;
-  operationModeNode.setTimerSetting(ts);
+  // settings changed via MQTT survive a reboot, unless the configuration changed since
+  ControlSettings configured;
+  memset(&configured, 0, sizeof(configured));
+  strncpy(configured.mode, operationModeSetting.get(), sizeof(configured.mode) - 1);
+  configured.poolMax           = centiFromCelsius(temperatureMaxPoolSetting.get());
+  configured.solarMin          = centiFromCelsius(temperatureMinSolarSetting.get());
+  configured.hysteresis        = centiFromCelsius(temperatureHysteresisSetting.get());
+  configured.timerStartHour    = 10;  //TODO: Configurable
+  configured.timerStartMinutes = 30;
+  configured.timerEndHour      = 17;
+  configured.timerEndMinutes   = 30;
+
+  ControlSettings settings;
+  settingsStore.load(settings, configured);
+  operationModeNode.applySettings(settings);
 
   operationModeNode.setPoolTemperatureNode(&poolTemperatureNode);
   operationModeNode.setSolarTemperatureNode(&solarTemperatureNode);
 
   // add the rules
-  RuleAuto* autoRule = new RuleAuto(&solarPumpNode, &poolPumpNode);
-  operationModeNode.addRule(autoRule);
+  operationModeNode.addRule(&autoRule);
+  operationModeNode.addRule(&manuRule);
+  operationModeNode.addRule(&boostRule);
+  operationModeNode.addRule(&timerRule);
+
+  filterRule.setPoolVolume(poolVolumeSetting.get());
+  filterRule.setPumpFlow(pumpFlowSetting.get());
+  filterRule.getPlanner().setMinRun((filterMinRunSetting.get() * 60 + FiltrationPlanner::SLOT_SECONDS - 1) /
+                                    FiltrationPlanner::SLOT_SECONDS);
+  tariffNode.setPlanner(&filterRule.getPlanner());
+  operationModeNode.addRule(&filterRule);
+
+  predictRule.setHorizon(predictHorizonSetting.get());
+  operationModeNode.addRule(&predictRule);
+
+  diagnosticsNode.setOperationModeNode(&operationModeNode);
+
+  // heat gained by the solar heating, from the collector probes if there are any
+  solarGainNode.setPublishInterval(_loopInterval);
+  solarGainNode.setPoolTemperatureNode(&poolTemperatureNode);
+  solarGainNode.setCollectorNodes((COLLECTOR_INLET >= 0) ? &temperatureNodes[COLLECTOR_INLET] : nullptr,
+                                  (COLLECTOR_OUTLET >= 0) ? &temperatureNodes[COLLECTOR_OUTLET] : nullptr);
+  solarGainNode.setSolarPumpNode(&solarPumpNode);
+  solarGainNode.setOperationModeNode(&operationModeNode);
+  solarGainNode.setPoolVolume(poolVolumeSetting.get());
+  solarGainNode.setFlow(pumpFlowSetting.get());
+
+  // local JSON API, independent of MQTT
+  httpApi.setOperationModeNode(&operationModeNode);
+  httpApi.setSensors(temperatureNodes.begin(), SENSOR_COUNT);
+  httpApi.setRelays(relayNodes.begin(), RELAY_COUNT);
+  httpApi.setPlanner(&filterRule.getPlanner());
+  httpApi.begin(httpPortSetting.get());
+  if (httpApi.isRunning()) {
+    scheduler.addPeriodic("history", [](void*) { sampleHistory(); }, nullptr, History::INTERVAL, 0);
+  }
 
-  RuleManu* manuRule = new RuleManu();
-  operationModeNode.addRule(manuRule);
+  // rules are complete now
+  operationModeNode.triggerEvaluation();
+}
 
-  RuleBoost* boostRule = new RuleBoost(&solarPumpNode, &poolPumpNode);
-  operationModeNode.addRule(boostRule);
+/**
+ * Homie Setup handler.
+ * Only called when wifi and mqtt are connected.
+ */
+void setupHandler() {
+  bootProfile.mark(BOOT_MQTT);
 
-  RuleTimer* timerRule = new RuleTimer(&solarPumpNode, &poolPumpNode);
-  operationModeNode.addRule(timerRule);
+  // publish the current state right away
+  operationModeNode.triggerEvaluation();
+  diagnosticsNode.triggerPublish();
+}
 
-  _lastMeasurement = 0;
+/**
+ * Homie event handler.
+ */
+void onHomieEvent(const HomieEvent& event) {
+  switch (event.type) {
+    case HomieEventType::OTA_STARTED:
+      powerManager.suspend(true);
+      break;
+    case HomieEventType::OTA_FAILED:
+    case HomieEventType::OTA_SUCCESSFUL:
+      powerManager.suspend(false);
+      break;
+    case HomieEventType::ABOUT_TO_RESET:
+      relayStateStore.flush();
+      settingsStore.flush();
+      break;
+    default:
+      break;
+  }
 }
 
 /**
  * Startup of controller.
+ *
+ * Relays come first, then the sensors; configuration and network follow in Homie.setup().
  */
 void setup() {
+  bootProfile.begin();
   Serial.begin(SERIAL_SPEED);
+  Homie.setLoggingPrinter(&Serial);
 
-  while (!Serial) {
-    ;  // wait for serial port to connect. Needed for native USB port only
+  // restore the relays, keeping the solar pump behind the pool pump
+  relaySequencer.setStaggerDelay(DEFAULT_RELAY_STAGGER);
+  relaySequencer.setDependency(&solarPumpNode, &poolPumpNode, DEFAULT_SOLAR_PUMP_DELAY);
+  for (RelayModuleNode& node : relayNodes) {
+    node.begin();
   }
-  Homie.setLoggingPrinter(&Serial);
+  relaySequencer.loop();
+  bootProfile.mark(BOOT_RELAYS);
+
+  for (DallasTemperatureNode& node : temperatureNodes) {
+    node.begin();
+#if SENSOR_TASK
+    sensorTask.add(&node);
+#endif
+  }
+#if SENSOR_TASK
+  sensorTask.begin();
+#endif
+  bootProfile.mark(BOOT_SENSORS);
 
   Homie_setFirmware("pool-controller", "2.0.0");
   Homie_setBrand("smart-swimmingpool");
@@ -139,15 +310,88 @@ void setup() {
   temperatureHysteresisSetting.setDefaultValue(1.0).setValidator(
       [](long candidate) { return (candidate >= 0) && (candidate <= 10); });
 
+  relayMinOnTimeSetting.setDefaultValue(120).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 3600);
+  });
+
+  relayMinOffTimeSetting.setDefaultValue(120).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 3600);
+  });
+
+  relayStaggerSetting.setDefaultValue(DEFAULT_RELAY_STAGGER).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 60);
+  });
+
+  solarPumpDelaySetting.setDefaultValue(DEFAULT_SOLAR_PUMP_DELAY).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 600);
+  });
+
+  poolPumpPowerSetting.setDefaultValue(0).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 5000);
+  });
+
+  solarPumpPowerSetting.setDefaultValue(0).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 5000);
+  });
+
   operationModeSetting.setDefaultValue("auto").setValidator([](const char* candidate) {
-    return (strcmp(candidate, "auto")) || (strcmp(candidate, "manu")) || (strcmp(candidate, "boost"));
+    return (strcmp(candidate, "auto") == 0) || (strcmp(candidate, "manu") == 0) || (strcmp(candidate, "boost") == 0) ||
+           (strcmp(candidate, "timer") == 0) || (strcmp(candidate, "filter") == 0) || (strcmp(candidate, "predict") == 0);
+  });
+
+  // 0 disables the volume based filtration, rule "filter" falls back to the timer then
+  poolVolumeSetting.setDefaultValue(0.0).setValidator([](double candidate) {
+    return (candidate >= 0) && (candidate <= 500);
+  });
+
+  pumpFlowSetting.setDefaultValue(0.0).setValidator([](double candidate) {
+    return (candidate >= 0) && (candidate <= 100);
+  });
+
+  filterMinRunSetting.setDefaultValue(30).setValidator([](long candidate) {
+    return (candidate >= 30) && (candidate <= 120);
+  });
+
+  predictHorizonSetting.setDefaultValue(30).setValidator([](long candidate) {
+    return (candidate >= 5) && (candidate <= 240);
+  });
+
+  diagnosticsIntervalSetting.setDefaultValue(5).setValidator([](long candidate) {
+    return (candidate >= 1) && (candidate <= 60);
+  });
+
+  heapRestartSetting.setDefaultValue(0).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 32768);
+  });
+
+  powerModeSetting.setDefaultValue("off").setValidator([](const char* candidate) {
+    return (strcmp(candidate, "off") == 0) || (strcmp(candidate, "modem") == 0) || (strcmp(candidate, "light") == 0);
+  });
+
+  httpPortSetting.setDefaultValue(80).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 65535);
   });
 
   //Homie.disableLogging();
   Homie.setSetupFunction(setupHandler);
+  Homie.onEvent(onHomieEvent);
+
+  // work outside of the nodes, the nodes add their tasks in Homie.setup()
+  scheduler.addPeriodic("relay-sequencer", [](void*) { relaySequencer.loop(); }, nullptr, SEQUENCER_INTERVAL);
+  scheduler.addPeriodic("relay-store", [](void*) { relayStateStore.loop(); }, nullptr, STORE_INTERVAL);
+  scheduler.addPeriodic("heap", [](void*) { heapMonitor.sample(); }, nullptr, HeapMonitor::SAMPLE_INTERVAL);
+#if LOOP_PROFILER
+  homieProfile = loopProfiler.addSlot("homie", "loop");
+#endif
 
   LN.log(__PRETTY_FUNCTION__, LoggerNode::DEBUG, "Before Homie setup())");
   Homie.setup();
+  bootProfile.mark(BOOT_NETWORK);
+
+  if (Homie.isConfigured()) {
+    setupControl();
+    bootProfile.mark(BOOT_CONTROL);
+  }
 
   LN.logf(__PRETTY_FUNCTION__, LoggerNode::DEBUG, "Free heap: %d", ESP.getFreeHeap());
   Homie.getLogger() << F("Free heap: ") << ESP.getFreeHeap() << endl;
@@ -158,5 +402,10 @@ void setup() {
  */
 void loop() {
 
-  Homie.loop();
+  {
+    PROFILE_SCOPE(homieProfile);
+    Homie.loop();
+  }
+  scheduler.run();
+  powerManager.idle();
 }